@@ -0,0 +1,41 @@
+# Two-stage profile-guided build, run by the "pgo" target:
+#   1. build an instrumented goodness (GOODNESS_PGO=GENERATE)
+#   2. train it with anneal-bench on the words file
+#   3. rebuild using the profile (GOODNESS_PGO=USE)
+# Both stages use the same build directory because GCC names profile
+# files after the object file paths.
+
+set(profile "${BINARY_DIR}/pgo-profile")
+file(REMOVE_RECURSE "${profile}")
+
+set(dir "${BINARY_DIR}/pgo")
+foreach(stage GENERATE USE)
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${dir}" -G "${GENERATOR}"
+            -DCMAKE_CXX_COMPILER=${CXX}
+            -DCMAKE_BUILD_TYPE=Release
+            -DGOODNESS_PGO=${stage}
+            -DGOODNESS_PGO_DIR=${profile}
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "configuring ${dir} failed")
+  endif()
+  execute_process(COMMAND ${CMAKE_COMMAND} --build "${dir}" --target goodness
+                  RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "building ${dir} failed")
+  endif()
+
+  if(stage STREQUAL "GENERATE")
+    execute_process(
+      COMMAND "${dir}/goodness" words=${WORDS} stats=0 steps=32 threads=1
+              out=${dir}/scaling.csv anneal-bench
+      WORKING_DIRECTORY "${dir}"
+      RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+      message(FATAL_ERROR "training run failed")
+    endif()
+  endif()
+endforeach()
+
+message(STATUS "Profile-optimized binary: ${dir}/goodness")
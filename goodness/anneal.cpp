@@ -0,0 +1,173 @@
+/*************************************************************************
+ * Anneal
+ *
+ * The annealing chain and its progress reporting; see
+ * goodness/anneal.h.
+ *************************************************************************/
+#include "goodness/anneal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+namespace goodness
+{
+HashParams neighbour(const HashParams &state, mt19937 &random)
+{
+   HashParams next = state;
+   unsigned int choice = random() % 5;
+   if (choice == 0)
+      next.multiplier ^= 1u << (random() % 32);
+   else
+   {
+      int &shift = next.shifts[choice - 1];
+      shift += (random() & 1) ? 1 : -1;
+      shift = max(1, min(31, shift));
+   }
+   return next;
+}
+
+AnnealResult Annealer::run(long steps, const HashParams &start)
+{
+   TraceScope chain("anneal chain");
+   uniform_real_distribution<double> uniform(0.0, 1.0);
+
+   HashParams state = start;
+   double current = energy(state);
+
+   AnnealResult result;
+   result.best = state;
+   result.bestEnergy = current;
+   result.evaluations = 1;
+   result.accepted = 0;
+
+   for (long k = 1; k <= steps; k++)
+   {
+      ScopedTimer timer(PHASE_ANNEAL_STEP, 1);
+      double temperature = 100.0 / k;
+      HashParams next = neighbour(state, random);
+      double nextEnergy = energy(next);
+      result.evaluations++;
+
+      if (nextEnergy < current ||
+          exp(-(nextEnergy - current) / temperature) > uniform(random))
+      {
+         state = next;
+         current = nextEnergy;
+         result.accepted++;
+      }
+      if (nextEnergy < result.bestEnergy)
+      {
+         result.best = next;
+         result.bestEnergy = nextEnergy;
+      }
+      if (progress)
+         progress->publish(k, steps, result.accepted, temperature, current,
+                           result.bestEnergy);
+   }
+
+   result.wordsHashed = result.evaluations * (long) energy.size();
+   return result;
+}
+
+AnnealResult anneal(const vector<string_view> &words, long steps,
+                    unsigned int seed, AnnealProgress *progress)
+{
+   Annealer annealer(words, seed);
+   annealer.setProgress(progress);
+   return annealer.run(steps);
+}
+
+ProgressReporter::ProgressReporter(const vector<AnnealProgress> &chains,
+                                   double interval, const string &file)
+   : chains(chains), interval(interval), json(false), stopping(false),
+     lastEvaluations(chains.size(), 0), start(Clock::now()), last(start)
+{
+   if (!file.empty())
+   {
+      if (this->interval <= 0)
+         this->interval = 1;
+      json = file.size() > 6 && file.substr(file.size() - 6) == ".jsonl";
+      ifstream existing(file.c_str());
+      bool header = !json && !existing.good();
+      existing.close();
+      out.open(file.c_str(), ios::app);
+      if (header)
+         out << "elapsed_s,chain,iteration,steps,temperature,energy,"
+             << "best_energy,acceptance,evals_per_s" << endl;
+   }
+   if (this->interval > 0)
+      reporter = thread(&ProgressReporter::run, this);
+}
+
+void ProgressReporter::stop()
+{
+   if (!reporter.joinable())
+      return;
+   {
+      lock_guard<mutex> lock(wakeLock);
+      stopping = true;
+   }
+   wake.notify_all();
+   reporter.join();
+   snapshot();
+}
+
+void ProgressReporter::run()
+{
+   unique_lock<mutex> lock(wakeLock);
+   while (!wake.wait_for(lock, chrono::duration<double>(interval),
+                         [this] { return stopping; }))
+      snapshot();
+}
+
+void ProgressReporter::snapshot()
+{
+   Clock::time_point now = Clock::now();
+   double elapsed = chrono::duration<double>(now - start).count();
+   double delta = chrono::duration<double>(now - last).count();
+   last = now;
+
+   for (size_t c = 0; c < chains.size(); c++)
+   {
+      const AnnealProgress &chain = chains[c];
+      long iteration = chain.iteration.load(memory_order_relaxed);
+      long steps = chain.steps.load(memory_order_relaxed);
+      long accepted = chain.accepted.load(memory_order_relaxed);
+      double temperature = chain.temperature.load(memory_order_relaxed);
+      double energy = chain.energy.load(memory_order_relaxed);
+      double best = chain.bestEnergy.load(memory_order_relaxed);
+      double acceptance = iteration ? (double) accepted / iteration : 0;
+      double rate = delta > 0 ? (iteration - lastEvaluations[c]) / delta
+                              : 0;
+      lastEvaluations[c] = iteration;
+
+      cerr << "[" << fixed << setprecision(1) << elapsed << "s] chain "
+           << c << ": step " << iteration << "/" << steps
+           << setprecision(4) << " T=" << temperature
+           << setprecision(7) << " energy=" << energy
+           << " best=" << best << setprecision(1)
+           << " accepted=" << 100 * acceptance << "%"
+           << " evals/s=" << rate << endl;
+      cerr.unsetf(ios::fixed);
+      cerr << setprecision(6);
+
+      if (!out.is_open())
+         continue;
+      if (json)
+         out << "{\"elapsed_s\":" << elapsed << ",\"chain\":" << c
+             << ",\"iteration\":" << iteration << ",\"steps\":" << steps
+             << ",\"temperature\":" << temperature
+             << ",\"energy\":" << energy << ",\"best_energy\":" << best
+             << ",\"acceptance\":" << acceptance
+             << ",\"evals_per_s\":" << rate << "}" << endl;
+      else
+         out << elapsed << ',' << c << ',' << iteration << ',' << steps
+             << ',' << temperature << ',' << energy << ',' << best << ','
+             << acceptance << ',' << rate << endl;
+   }
+}
+}
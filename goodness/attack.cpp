@@ -0,0 +1,201 @@
+/*************************************************************************
+ * Attack
+ *
+ * Colliding key sets and the adversarial score of HashParams; see
+ * goodness/attack.h.
+ *************************************************************************/
+#include "goodness/attack.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+namespace goodness
+{
+string AttackTarget::name() const
+{
+   if (family)
+      return family->name;
+   ostringstream out;
+   out << params;
+   return out.str();
+}
+
+// a random block of printable characters packed one per byte, so a
+// block of up to 8 characters is stored and compared as one integer
+static uint64_t randomBlock(mt19937_64 &random, size_t length)
+{
+   uint64_t block = 0;
+   for (size_t i = 0; i < length; i++)
+      block |= (uint64_t) (32 + random() % 95) << (8 * i);
+   return block;
+}
+
+static string unpackBlock(uint64_t block, size_t length)
+{
+   string text(length, ' ');
+   for (size_t i = 0; i < length; i++)
+      text[i] = (char) (block >> (8 * i));
+   return text;
+}
+
+vector<BlockPair> findCollidingBlocks(const AttackTarget &target,
+                                      size_t count, size_t length,
+                                      int threads, uint64_t seed,
+                                      uint64_t budget, uint64_t *tried)
+{
+   length = min(length, (size_t) 8);
+
+   // the threads hash one slice each of the blocks, which are then
+   // sorted by full hash so equal ones are neighbours; birthday odds
+   // give about n^2 / 2^33 pairs from n blocks of a 32-bit hash
+   vector<pair<uint64_t, uint64_t> > blocks(budget);
+   vector<thread> workers;
+   for (int t = 0; t < threads; t++)
+      workers.push_back(thread([&, t]()
+      {
+         mt19937_64 random(mix64(seed + t));
+         for (uint64_t i = budget * t / threads;
+              i < budget * (t + 1) / threads; i++)
+         {
+            uint64_t block = randomBlock(random, length);
+            string text = unpackBlock(block, length);
+            blocks[i] = make_pair(target.full(text), block);
+         }
+      }));
+   for (int t = 0; t < threads; t++)
+      workers[t].join();
+   sort(blocks.begin(), blocks.end());
+   if (tried)
+      *tried = budget;
+
+   vector<BlockPair> pairs;
+   for (uint64_t i = 1; i < budget && pairs.size() < count; i++)
+      if (blocks[i].first == blocks[i - 1].first &&
+          blocks[i].second != blocks[i - 1].second)
+      {
+         BlockPair pair;
+         pair.first = unpackBlock(blocks[i - 1].second, length);
+         pair.second = unpackBlock(blocks[i].second, length);
+         pairs.push_back(pair);
+      }
+   return pairs;
+}
+
+vector<string> blockKeys(const vector<BlockPair> &pairs, size_t count)
+{
+   vector<string> keys;
+   if (pairs.empty())
+      return keys;
+   if (pairs.size() < 63)
+      count = min(count, (size_t) 1 << pairs.size());
+   for (size_t k = 0; k < count; k++)
+   {
+      // bit i of k picks the block from pair i
+      string key;
+      for (size_t i = 0; i < pairs.size(); i++)
+         key += (k >> i) & 1 ? pairs[i].second : pairs[i].first;
+      keys.push_back(key);
+   }
+   return keys;
+}
+
+vector<string> bruteForceKeys(const AttackTarget &target, size_t count,
+                              int threads, uint64_t seed, uint64_t budget,
+                              uint64_t *tried)
+{
+   mt19937_64 first(seed);
+   string firstKey = unpackBlock(randomBlock(first, 8), 8);
+   unsigned int goal = target.index(firstKey);
+
+   vector<string> keys(1, firstKey);
+   mutex keysLock;
+   atomic<bool> done(count <= 1);
+   atomic<uint64_t> hashed(1);
+
+   vector<thread> workers;
+   for (int t = 0; t < threads; t++)
+      workers.push_back(thread([&, t]()
+      {
+         mt19937_64 random(mix64(seed + 1 + t));
+         char key[16];
+         uint64_t i = 0;
+         for (; i < budget && !done.load(memory_order_relaxed); i++)
+         {
+            // 16 printable characters, two random blocks
+            uint64_t low = randomBlock(random, 8);
+            uint64_t high = randomBlock(random, 8);
+            memcpy(key, &low, 8);
+            memcpy(key + 8, &high, 8);
+            string_view view(key, sizeof(key));
+            if (target.index(view) != goal)
+               continue;
+
+            lock_guard<mutex> guard(keysLock);
+            if (keys.size() < count)
+               keys.push_back(string(view));
+            if (keys.size() >= count)
+               done.store(true);
+         }
+         hashed.fetch_add(i);
+      }));
+   for (int t = 0; t < threads; t++)
+      workers[t].join();
+
+   if (tried)
+      *tried = hashed.load();
+   return keys;
+}
+
+double adversarialPartners(const HashParams &params, int length)
+{
+   // the difference vectors d with every |d[i]| <= 94: d[0..length-2]
+   // are enumerated, and the last one is whatever makes the sum zero
+   length = max(1, min(length, 3));
+   uint32_t m = params.multiplier;
+   int chosen = length - 1;
+   long vectors = 1;
+   for (int i = 0; i < chosen; i++)
+      vectors *= 189;
+
+   double pairs = 0;
+   for (long v = 0; v < vectors; v++)
+   {
+      int d[3];
+      long rest = v;
+      uint32_t sum = 0;
+      double strings = 1;
+      bool zero = true;
+      for (int i = 0; i < chosen; i++)
+      {
+         d[i] = (int) (rest % 189) - 94;
+         rest /= 189;
+         sum = sum * m + (uint32_t) d[i];
+         zero = zero && d[i] == 0;
+      }
+      sum *= m;
+      int64_t last = -(int64_t) (int32_t) sum;
+      if (last < -94 || last > 94 || (zero && last == 0))
+         continue;
+      d[chosen] = (int) last;
+
+      // the ordered pairs (s, s + d) with both strings printable
+      for (int i = 0; i < length; i++)
+         strings *= 95 - abs(d[i]);
+      pairs += strings;
+   }
+
+   double total = 1;
+   for (int i = 0; i < length; i++)
+      total *= 95;
+   return pairs / total;
+}
+}
@@ -0,0 +1,315 @@
+/*************************************************************************
+ * Corpus
+ *
+ * The binary corpus format, Corpus, CorpusGenerator and the storage
+ * layouts for hashing kernels; see goodness/corpus.h.
+ *************************************************************************/
+#include "goodness/corpus.h"
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+#include "goodness/families.h"
+#include "goodness/instrument.h"
+
+using namespace std;
+
+namespace goodness
+{
+const char CORPUS_MAGIC[8] = { 'G', 'D', 'N', 'S', 'C', 'R', 'P', '1' };
+
+void writeCorpusHeader(ostream &out, unsigned long long count)
+{
+   out.write(CORPUS_MAGIC, sizeof(CORPUS_MAGIC));
+   out.write((const char *) &count, sizeof(count));
+}
+
+void writeCorpusWord(ostream &out, const string &word)
+{
+   unsigned int length = word.length();
+   out.write((const char *) &length, sizeof(length));
+   out.write(word.data(), length);
+}
+
+bool isBinaryCorpus(istream &in)
+{
+   char magic[sizeof(CORPUS_MAGIC)];
+   in.read(magic, sizeof(magic));
+   bool binary = in.gcount() == sizeof(magic) &&
+                 memcmp(magic, CORPUS_MAGIC, sizeof(magic)) == 0;
+   in.clear();
+   in.seekg(binary ? sizeof(magic) : 0);
+   return binary;
+}
+
+uint32_t Corpus::add(string_view word)
+{
+   uint64_t h = wordHash64(word.data(), word.length(), 0);
+   size_t mask = table.size() - 1;
+   size_t slot = h & mask;
+   for (; table[slot] != EMPTY; slot = (slot + 1) & mask)
+      if (unique[table[slot]] == word)
+      {
+         ids.push_back(table[slot]);
+         sequence.push_back(unique[table[slot]]);
+         return table[slot];
+      }
+
+   uint32_t id = unique.size();
+   table[slot] = id;
+   unique.push_back(store(word));
+   hashes.push_back(h);
+   ids.push_back(id);
+   sequence.push_back(unique[id]);
+   if (unique.size() * 2 > table.size())
+      grow();
+   return id;
+}
+
+bool Corpus::load(string file)
+{
+   ifstream fin(file.c_str(), ios::binary);
+   if (fin.fail())
+      return false;
+
+   string word;
+   if (isBinaryCorpus(fin))
+   {
+      ScopedTimer loading(PHASE_LOAD);
+      unsigned long long count = 0;
+      unsigned int length;
+      fin.read((char *) &count, sizeof(count));
+      reserve(count);
+      // a file cut short is an error, not a shorter corpus
+      for (unsigned long long i = 0; i < count; i++)
+      {
+         if (!fin.read((char *) &length, sizeof(length)))
+            return false;
+         word.resize(length);
+         if (!fin.read(word.data(), length))
+            return false;
+         add(word);
+      }
+      loading.addItems(sequence.size());
+      return true;
+   }
+
+   // tokenize large blocks in place; only a word split across two
+   // blocks is copied
+   vector<char> block(1 << 20);
+   while (true)
+   {
+      size_t size;
+      {
+         ScopedTimer reading(PHASE_LOAD);
+         fin.read(block.data(), block.size());
+         size = fin.gcount();
+      }
+      if (size == 0)
+         break;
+
+      ScopedTimer tokenizing(PHASE_TOKENIZE);
+      size_t before = sequence.size();
+      size_t start = 0;
+      for (size_t i = 0; i <= size; i++)
+      {
+         if (i < size && !isspace((unsigned char) block[i]))
+            continue;
+         if (i == size)
+         {
+            word.append(block.data() + start, size - start);
+            break;
+         }
+         if (!word.empty())
+         {
+            word.append(block.data() + start, i - start);
+            add(word);
+            word.clear();
+         }
+         else if (i > start)
+            add(string_view(block.data() + start, i - start));
+         start = i + 1;
+      }
+      tokenizing.addItems(sequence.size() - before);
+   }
+   if (!word.empty())
+      add(word);
+   return true;
+}
+
+size_t Corpus::bytes() const
+{
+   return slabs.size() * SLAB_SIZE +
+          unique.capacity() * sizeof(string_view) +
+          sequence.capacity() * sizeof(string_view) +
+          (ids.capacity() + table.capacity()) * sizeof(uint32_t) +
+          hashes.capacity() * sizeof(uint64_t);
+}
+
+string_view Corpus::store(string_view word)
+{
+   if (word.length() > SLAB_SIZE / 4)
+   {
+      // too big to share a slab
+      large.push_back(unique_ptr<char[]>(new char[word.length()]));
+      memcpy(large.back().get(), word.data(), word.length());
+      return string_view(large.back().get(), word.length());
+   }
+   if (slabUsed + word.length() > SLAB_SIZE)
+   {
+      slabs.push_back(unique_ptr<char[]>(new char[SLAB_SIZE]));
+      slabUsed = 0;
+   }
+   char *bytes = slabs.back().get() + slabUsed;
+   memcpy(bytes, word.data(), word.length());
+   slabUsed += word.length();
+   return string_view(bytes, word.length());
+}
+
+void Corpus::grow()
+{
+   table.assign(table.size() * 2, EMPTY);
+   size_t mask = table.size() - 1;
+   for (uint32_t id = 0; id < unique.size(); id++)
+   {
+      size_t slot = hashes[id] & mask;
+      while (table[slot] != EMPTY)
+         slot = (slot + 1) & mask;
+      table[slot] = id;
+   }
+}
+
+CorpusGenerator::CorpusGenerator(string kind, unsigned long long count,
+                                 unsigned long long seed)
+   : kind(kind), count(count), index(0), random(seed)
+{
+   base = 1000000 + random() % 1000000000000ULL;
+   blocks = 1;
+   while (blocks < 63 && (1ULL << blocks) < count)
+      blocks++;
+   mask = random() & ((1ULL << blocks) - 1);
+}
+
+bool CorpusGenerator::valid() const
+{
+   return kind == "random" || kind == "url" || kind == "numeric" ||
+          kind == "prefix" || kind == "adversarial";
+}
+
+string CorpusGenerator::next()
+{
+   string word;
+   if (kind == "random")
+   {
+      int length = 1 + random() % 16;
+      for (int i = 0; i < length; i++)
+         word += (char) (33 + random() % 94);
+   }
+   else if (kind == "url")
+   {
+      word = "https://www.site" + to_string(random() % 1000) + ".com";
+      int segments = 1 + random() % 3;
+      for (int i = 0; i < segments; i++)
+         word += "/" + lowercase(3 + random() % 6);
+      if (random() % 2)
+         word += "?id=" + to_string(random() % 100000);
+   }
+   else if (kind == "numeric")
+      word = to_string(base + index);
+   else if (kind == "prefix")
+      word = "user_profile_settings_" + lowercase(4 + random() % 5);
+   else if (kind == "adversarial")
+   {
+      unsigned long long bits = index ^ mask;
+      for (int i = 0; i < blocks; i++)
+         word += (bits >> i) & 1 ? "BB" : "Aa";
+   }
+   index++;
+   return word;
+}
+
+string CorpusGenerator::lowercase(int length)
+{
+   string text(length, 'a');
+   for (int i = 0; i < length; i++)
+      text[i] += random() % 26;
+   return text;
+}
+
+PaddedCorpus::PaddedCorpus(const vector<string_view> &words)
+{
+   size_t total = 0;
+   for (size_t i = 0; i < words.size(); i++)
+      total += (words[i].length() + 15) & ~(size_t) 7;
+   bytes.assign(total, 0);
+   offsets.reserve(words.size());
+   lengths.reserve(words.size());
+
+   size_t at = 0;
+   for (size_t i = 0; i < words.size(); i++)
+   {
+      memcpy(&bytes[at], words[i].data(), words[i].length());
+      offsets.push_back(at);
+      lengths.push_back(words[i].length());
+      at += (words[i].length() + 15) & ~(size_t) 7;
+   }
+}
+
+LengthBuckets::LengthBuckets(const vector<string_view> &words)
+   : count(words.size())
+{
+   buckets.resize(MAX_LENGTH + 1);
+   for (size_t i = 0; i < words.size(); i++)
+   {
+      if (words[i].length() > MAX_LENGTH)
+      {
+         longIndex.push_back(i);
+         longWords.push_back(words[i]);
+      }
+      else
+         buckets[words[i].length()].index.push_back(i);
+   }
+
+   for (size_t length = 0; length <= MAX_LENGTH; length++)
+   {
+      Bucket &bucket = buckets[length];
+      bucket.length = length;
+      bucket.lanes = (bucket.index.size() + LANES - 1) / LANES * LANES;
+      bucket.matrix.assign(length * bucket.lanes, 0);
+      for (size_t j = 0; j < bucket.index.size(); j++)
+      {
+         string_view word = words[bucket.index[j]];
+         for (size_t pos = 0; pos < length; pos++)
+            bucket.matrix[pos * bucket.lanes + j] = word[pos];
+      }
+   }
+}
+
+void LengthBuckets::hashAll(const HashParams &params,
+                            vector<unsigned int> &hashes,
+                            vector<uint32_t> &lanes) const
+{
+   hashes.resize(count);
+   const uint32_t multiplier = params.multiplier;
+   for (size_t length = 0; length <= MAX_LENGTH; length++)
+   {
+      const Bucket &bucket = buckets[length];
+      if (bucket.index.empty())
+         continue;
+
+      lanes.assign(bucket.lanes, 0);
+      uint32_t *h = &lanes[0];
+      for (size_t pos = 0; pos < length; pos++)
+      {
+         const int8_t *row = &bucket.matrix[pos * bucket.lanes];
+         for (size_t j = 0; j < bucket.lanes; j++)
+            h[j] = multiplier * h[j] + (uint32_t) row[j];
+      }
+      for (size_t j = 0; j < bucket.index.size(); j++)
+         hashes[bucket.index[j]] = h[j] % HASH_SIZE;
+   }
+   for (size_t i = 0; i < longWords.size(); i++)
+      hashes[longIndex[i]] = hashWith(params, longWords[i]);
+}
+}
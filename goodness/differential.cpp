@@ -0,0 +1,82 @@
+/*************************************************************************
+ * Differential
+ *
+ * Kernel-against-reference comparison of one input; see
+ * goodness/differential.h.
+ *************************************************************************/
+#include "goodness/differential.h"
+
+#include <cstring>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include "goodness/corpus.h"
+#include "goodness/families.h"
+#include "goodness/hash.h"
+
+using namespace std;
+
+namespace goodness
+{
+uint32_t signedPolyHash(const char *data, size_t length, uint32_t multiplier)
+{
+   uint32_t h = 0;
+   for (size_t i = 0; i < length; i++)
+      h = multiplier * h + (uint32_t) (int8_t) data[i];
+   return h;
+}
+
+string kernelMismatch(const char *data, size_t length, uint64_t seed)
+{
+   // the padded kernels need 8-aligned storage with 8 readable bytes
+   // past the end
+   vector<uint64_t> storage((length + 15) / 8 + 1, 0);
+   char *padded = (char *) &storage[0];
+   memcpy(padded, data, length);
+   string_view word(data, length);
+
+   HashParams params;
+   params.multiplier = (uint32_t) mix64(seed ^ length) | 1;
+   vector<string_view> words(1, word);
+   LengthBuckets buckets(words);
+   vector<unsigned int> lanes;
+   vector<uint32_t> scratch;
+   buckets.hashAll(params, lanes, scratch);
+
+   uint64_t poly = signedPolyHash(data, length, 31);
+   struct
+   {
+      const char *name;
+      uint64_t actual;
+      uint64_t expected;
+   } checks[] =
+   {
+      { "poly32", polyHash32(data, length, seed), poly },
+      { "poly32-wide", polyHash32Wide(data, length, seed), poly },
+      { "poly32-wide[pad]", polyHash32Padded(padded, length, seed), poly },
+      { "poly64 low half", (uint32_t) polyHash64(data, length, seed), poly },
+      { "fullHashWith", fullHashWith(HashParams(), word), poly },
+      { "hashWith", hashWith(params, word),
+        signedPolyHash(data, length, params.multiplier) % HASH_SIZE },
+      { "LengthBuckets::hashAll", lanes[0],
+        signedPolyHash(data, length, params.multiplier) % HASH_SIZE },
+      { "crc32c", crc32cHash(data, length, seed),
+        crc32cSoft(data, length, seed) },
+      { "clmul64", clmulHash(data, length, seed),
+        clmulHashSoft(data, length, seed) },
+      { "word64[pad]", wordHash64Padded(padded, length, seed),
+        wordHash64(data, length, seed) },
+   };
+
+   for (size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); c++)
+      if (checks[c].actual != checks[c].expected)
+      {
+         ostringstream out;
+         out << checks[c].name << " gave " << hex << checks[c].actual
+             << ", reference " << checks[c].expected;
+         return out.str();
+      }
+   return "";
+}
+}
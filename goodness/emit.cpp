@@ -0,0 +1,109 @@
+/*************************************************************************
+ * Emit
+ *
+ * Writing tuned parameters as a constexpr C++ header; see
+ * goodness/emit.h.
+ *************************************************************************/
+#include "goodness/emit.h"
+
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace goodness
+{
+string cString(const string &word)
+{
+   ostringstream out;
+   out << '"';
+   for (size_t i = 0; i < word.length(); i++)
+   {
+      unsigned char c = word[i];
+      if (c == '"' || c == '\\')
+         out << '\\' << c;
+      else if (c < 32 || c > 126)
+         out << '\\' << oct << setw(3) << setfill('0') << (int) c
+             << dec << setfill(' ');
+      else
+         out << c;
+   }
+   out << '"';
+   return out.str();
+}
+
+void writeHashHeader(ostream &out, const HashParams &params, double energy,
+                     const vector<string> &samples, const string &space)
+{
+   // the namespace in capitals, with each run of other characters (the
+   // "::" of a nested namespace) as one '_', so the guard is a name
+   string guard;
+   for (size_t i = 0; i < space.length(); i++)
+      if (isalnum((unsigned char) space[i]))
+         guard += (char) toupper((unsigned char) space[i]);
+      else if (guard.empty() || guard[guard.length() - 1] != '_')
+         guard += '_';
+   guard += "_H";
+
+   out << "/*************************************************************************" << endl
+       << " * Generated by goodness emit: do not edit." << endl
+       << " *" << endl
+       << " *    " << params << endl
+       << " *    average number of collisions: " << energy << endl
+       << " *" << endl
+       << " * index(s, n) is the table slot of the n bytes at s; rehash(h) is the" << endl
+       << " * secondary hash applied to an occupied slot.  Requires C++14." << endl
+       << " *************************************************************************/" << endl
+       << "#ifndef " << guard << endl
+       << "#define " << guard << endl
+       << endl
+       << "#include <cstddef>" << endl
+       << "#include <cstdint>" << endl
+       << endl
+       << "namespace " << space << endl
+       << "{" << endl
+       << "constexpr std::uint32_t MULTIPLIER = " << params.multiplier << "u;" << endl
+       << "constexpr std::uint32_t TABLE_SIZE = " << HASH_SIZE << "u;" << endl
+       << endl
+       << "// characters are taken as signed, like hashCode does on x86" << endl
+       << "constexpr std::uint32_t index(const char *s, std::size_t n)" << endl
+       << "{" << endl
+       << "   std::uint32_t h = 0;" << endl
+       << "   for (std::size_t i = 0; i < n; i++)" << endl
+       << "      h = MULTIPLIER * h + static_cast<std::uint32_t>(" << endl
+       << "                              static_cast<signed char>(s[i]));" << endl
+       << "   return h % TABLE_SIZE;" << endl
+       << "}" << endl
+       << endl
+       << "template <std::size_t N>" << endl
+       << "constexpr std::uint32_t index(const char (&s)[N])" << endl
+       << "{" << endl
+       << "   return index(s, N - 1);" << endl
+       << "}" << endl
+       << endl
+       << "constexpr std::uint32_t rehash(std::uint32_t h)" << endl
+       << "{" << endl
+       << "   h = h ^ (h >> " << params.shifts[0] << ") ^ (h >> "
+       << params.shifts[1] << ");" << endl
+       << "   return h ^ (h >> " << params.shifts[2] << ") ^ (h >> "
+       << params.shifts[3] << ");" << endl
+       << "}" << endl
+       << endl;
+
+   for (size_t i = 0; i < samples.size(); i++)
+      out << "static_assert(index(" << cString(samples[i]) << ") == "
+          << hashWith(params, samples[i]) << "u, \"self-test\");" << endl;
+   for (size_t i = 0; i < samples.size(); i++)
+   {
+      unsigned int h = hashWith(params, samples[i]);
+      out << "static_assert(rehash(" << h << "u) == "
+          << (unsigned int) safteyHashWith(params, h)
+          << "u, \"self-test\");" << endl;
+   }
+
+   out << "}" << endl
+       << endl
+       << "#endif // " << guard << endl;
+}
+}
@@ -0,0 +1,375 @@
+/*************************************************************************
+ * Energy
+ *
+ * calcEnergy and its in-memory, streaming and per-family equivalents;
+ * see goodness/energy.h.
+ *************************************************************************/
+#include "goodness/energy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include "goodness/instrument.h"
+
+using namespace std;
+
+namespace goodness
+{
+double calcEnergy(string filename)
+{
+    //open the file
+    ifstream fin(filename.c_str());
+    
+    if (fin.fail())
+        return -1;
+
+    map<int,int> collisionRecord;
+    
+    int temp;
+    
+    //for each value in the file
+    while (fin >> temp)
+    {
+        //if the map does not contains the key
+        if(collisionRecord.count(temp) == 0)
+            collisionRecord[temp] = 0;
+        else
+        {
+            //if there was a collision, apply the secondary hash
+            temp = safteyHash(temp);
+            
+            if(collisionRecord.count(temp) == 0)
+                collisionRecord[temp] = 0;
+            else
+                collisionRecord[temp] =  collisionRecord[temp] + 1;
+        }
+    }
+    
+    fin.close();
+    
+    //calculate the average
+    double average = 0;
+    
+    typedef map<int, int>::iterator it_type;
+    for(it_type iterator = collisionRecord.begin(); iterator != collisionRecord.end(); iterator++)
+    {
+        average += iterator->second;
+    }
+    
+    average /= (double) collisionRecord.size();
+
+    //return the average collisions
+    return average;
+}
+
+void hashFile(string file)
+{
+    ifstream fin(file.c_str());
+    ofstream fout("hashed");
+    
+    if (fin.fail() || fout.fail())
+    {
+        cerr << "Error reading file";
+        return;
+    }
+    
+    string word;
+    while (fin >> word)
+    {
+        fout << hashCode(word) << endl;
+    }
+    
+    fin.close();
+    fout.close();
+}
+
+double energyOf(const HashParams &params, const vector<string_view> &words,
+                Histogram &histogram)
+{
+   ScopedTimer timer(PHASE_ENERGY, words.size());
+   histogram.clear();
+   for (size_t i = 0; i < words.size(); i++)
+      histogram.add(params, hashWith(params, words[i]));
+   return histogram.average();
+}
+
+double familyEnergy(const HashFamily &family, uint64_t seed,
+                    const vector<string_view> &words, Histogram &histogram)
+{
+   ScopedTimer timer(PHASE_ENERGY, words.size());
+   HashParams params;
+   histogram.clear();
+   for (size_t i = 0; i < words.size(); i++)
+      histogram.add(params, reduceHash(family.hash(words[i].data(),
+                                                   words[i].length(), seed),
+                                       family.bits));
+   return histogram.average();
+}
+
+double bucketEnergyOf(const HashParams &params, const LengthBuckets &buckets,
+                      EnergyScratch &scratch)
+{
+   ScopedTimer timer(PHASE_ENERGY, buckets.size());
+   {
+      ScopedTimer hashing(PHASE_HASH, buckets.size());
+      buckets.hashAll(params, scratch.hashes, scratch.lanes);
+   }
+   ScopedTimer histogram(PHASE_HISTOGRAM, scratch.hashes.size());
+   scratch.histogram.clear();
+   for (size_t i = 0; i < scratch.hashes.size(); i++)
+      scratch.histogram.add(params, scratch.hashes[i]);
+   return scratch.histogram.average();
+}
+
+BatchEnergy::BatchEnergy(const vector<string_view> &words, int threads)
+   : buckets(words), scratch(max(1, threads)), adversarialWeight(0),
+     job(NULL), round(0), running(0), stopping(false)
+{
+   for (size_t t = 1; t < scratch.size(); t++)
+      workers.push_back(thread(&BatchEnergy::serve, this, t));
+}
+
+BatchEnergy::~BatchEnergy()
+{
+   {
+      lock_guard<mutex> guard(poolLock);
+      stopping = true;
+   }
+   wake.notify_all();
+   for (size_t t = 0; t < workers.size(); t++)
+      workers[t].join();
+}
+
+// a pool thread: runs each batch's job once on its own scratch
+void BatchEnergy::serve(size_t worker)
+{
+   unsigned long seen = 0;
+   unique_lock<mutex> guard(poolLock);
+   for (;;)
+   {
+      wake.wait(guard, [&]() { return stopping || round != seen; });
+      if (stopping)
+         return;
+      seen = round;
+      const function<void(EnergyScratch &)> *task = job;
+      guard.unlock();
+      (*task)(scratch[worker]);
+      guard.lock();
+      if (--running == 0)
+         finished.notify_one();
+   }
+}
+
+void BatchEnergy::operator()(const vector<HashParams> &candidates,
+                             vector<double> &energies)
+{
+   energies.assign(candidates.size(), 0);
+
+   // candidates in order of multiplier, cut into runs that share one,
+   // and no longer than an equal share per thread so a sweep of one
+   // multiplier's shifts still uses every thread
+   size_t share = max<size_t>(1, (candidates.size() + scratch.size() - 1) /
+                                 scratch.size());
+   vector<size_t> order(candidates.size());
+   for (size_t i = 0; i < order.size(); i++)
+      order[i] = i;
+   stable_sort(order.begin(), order.end(), [&candidates](size_t a, size_t b)
+   {
+      return candidates[a].multiplier < candidates[b].multiplier;
+   });
+   vector<size_t> runs;
+   for (size_t i = 0; i < order.size(); i++)
+      if (i == 0 || i - runs.back() == share ||
+          candidates[order[i]].multiplier !=
+          candidates[order[i - 1]].multiplier)
+         runs.push_back(i);
+   runs.push_back(order.size());
+
+   // each thread takes the next run until none are left
+   atomic<size_t> next(0);
+   function<void(EnergyScratch &)> work = [&](EnergyScratch &own)
+   {
+      for (size_t r = next++; r + 1 < runs.size(); r = next++)
+      {
+         const HashParams &first = candidates[order[runs[r]]];
+         {
+            ScopedTimer hashing(PHASE_HASH, buckets.size());
+            buckets.hashAll(first, own.hashes, own.lanes);
+         }
+         for (size_t i = runs[r]; i < runs[r + 1]; i++)
+         {
+            const HashParams &params = candidates[order[i]];
+            ScopedTimer histogram(PHASE_HISTOGRAM, own.hashes.size());
+            own.histogram.clear();
+            for (size_t w = 0; w < own.hashes.size(); w++)
+               own.histogram.add(params, own.hashes[w]);
+            double energy = own.histogram.average();
+            if (adversarialWeight > 0)
+               energy += adversarialWeight * adversarialPartners(params, 3);
+            energies[order[i]] = energy;
+         }
+      }
+   };
+
+   ScopedTimer timer(PHASE_ENERGY, buckets.size() * candidates.size());
+   {
+      lock_guard<mutex> guard(poolLock);
+      job = &work;
+      running = workers.size();
+      round++;
+   }
+   wake.notify_all();
+   work(scratch[0]);
+   unique_lock<mutex> guard(poolLock);
+   finished.wait(guard, [this]() { return running == 0; });
+   job = NULL;
+}
+
+DedupEnergy dedupEnergy(const HashParams &params, const Corpus &corpus,
+                        Histogram &all, Histogram &distinct)
+{
+   const vector<string_view> &words = corpus.words();
+   const vector<uint32_t> &ids = corpus.wordIds();
+   ScopedTimer timer(PHASE_ENERGY, words.size());
+   all.clear();
+   distinct.clear();
+
+   DedupEnergy result = { 0, 0, 0, 0, 0 };
+   uint32_t nextId = 0;
+   for (size_t i = 0; i < words.size(); i++)
+   {
+      unsigned int h = hashWith(params, words[i]);
+      all.add(params, h);
+      if (ids[i] == nextId)
+      {
+         distinct.add(params, h);
+         nextId++;
+      }
+      else
+         result.duplicates++;
+   }
+
+   for (size_t i = 0; i < all.touched.size(); i++)
+      result.collisions += all.counts[all.touched[i]];
+   for (size_t i = 0; i < distinct.touched.size(); i++)
+      result.trueCollisions += distinct.counts[distinct.touched[i]];
+   result.energy = all.average();
+   result.distinctEnergy = distinct.average();
+   return result;
+}
+
+size_t readChunk(istream *in, char *buffer, size_t size)
+{
+   in->read(buffer, size);
+   return in->gcount();
+}
+
+StreamResult streamEnergy(const HashParams &params, string file,
+                          size_t chunkBytes, Histogram &histogram)
+{
+   assert(chunkBytes > 0);
+   StreamResult result = { -1, 0, 0 };
+   ifstream fin(file.c_str(), ios::binary);
+   if (fin.fail())
+      return result;
+
+   histogram.clear();
+   bool binary = isBinaryCorpus(fin);
+   if (binary)
+      fin.ignore(sizeof(unsigned long long));   // the word count
+
+   vector<char> buffers[2] = { vector<char>(chunkBytes),
+                               vector<char>(chunkBytes) };
+   int current = 0;
+   future<size_t> pending = async(launch::async, readChunk, &fin,
+                                  &buffers[current][0], chunkBytes);
+
+   unsigned int h = 0;
+   bool inWord = false;               // text: inside a word
+   unsigned int lengthBytes = 0;      // binary: bytes of length read
+   unsigned int length = 0;
+   unsigned int remaining = 0;        // binary: word bytes still to come
+
+   ScopedTimer timer(PHASE_ENERGY);
+   size_t size;
+   while (true)
+   {
+      {
+         ScopedTimer waiting(PHASE_LOAD);   // time not hidden by hashing
+         size = pending.get();
+      }
+      if (size == 0)
+         break;
+      const char *chunk = &buffers[current][0];
+      current = 1 - current;
+      pending = async(launch::async, readChunk, &fin,
+                      &buffers[current][0], chunkBytes);
+      result.bytes += size;
+
+      for (size_t i = 0; i < size; i++)
+      {
+         char c = chunk[i];
+         if (!binary)
+         {
+            if (isspace((unsigned char) c))
+            {
+               if (inWord)
+               {
+                  histogram.add(params, h % HASH_SIZE);
+                  result.words++;
+                  inWord = false;
+                  h = 0;
+               }
+            }
+            else
+            {
+               h = params.multiplier * h + c;
+               inWord = true;
+            }
+         }
+         else if (remaining > 0)
+         {
+            h = params.multiplier * h + c;
+            if (--remaining == 0)
+            {
+               histogram.add(params, h % HASH_SIZE);
+               result.words++;
+               h = 0;
+            }
+         }
+         else
+         {
+            length |= (unsigned int) (unsigned char) c << (8 * lengthBytes);
+            if (++lengthBytes == sizeof(length))
+            {
+               remaining = length;
+               if (remaining == 0)
+               {
+                  histogram.add(params, 0);
+                  result.words++;
+               }
+               length = lengthBytes = 0;
+            }
+         }
+      }
+   }
+
+   if (inWord)
+   {
+      histogram.add(params, h % HASH_SIZE);
+      result.words++;
+   }
+   timer.addItems(result.words);
+   result.energy = histogram.average();
+   return result;
+}
+
+}
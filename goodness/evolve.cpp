@@ -0,0 +1,104 @@
+/*************************************************************************
+ * Evolve
+ *
+ * The genetic search over HashParams; see goodness/evolve.h.
+ *************************************************************************/
+#include "goodness/evolve.h"
+
+#include <algorithm>
+
+#include "goodness/anneal.h"
+#include "goodness/instrument.h"
+
+using namespace std;
+
+namespace goodness
+{
+HashParams Evolver::child(const vector<HashParams> &parents)
+{
+   // parents are sorted best first, so the best of three random picks
+   // is the one with the lowest index
+   size_t a = random() % parents.size();
+   size_t b = random() % parents.size();
+   for (int pick = 0; pick < 2; pick++)
+   {
+      a = min(a, (size_t) (random() % parents.size()));
+      b = min(b, (size_t) (random() % parents.size()));
+   }
+
+   HashParams next;
+   unsigned int mask = random();
+   next.multiplier = (parents[a].multiplier & mask) |
+                     (parents[b].multiplier & ~mask);
+   for (int s = 0; s < 4; s++)
+      next.shifts[s] = random() & 1 ? parents[a].shifts[s]
+                                    : parents[b].shifts[s];
+   for (unsigned int steps = random() % 3; steps > 0; steps--)
+      next = neighbour(next, random);
+   return next;
+}
+
+EvolveResult Evolver::run(long generations, size_t population,
+                          const HashParams &start)
+{
+   TraceScope search("evolve");
+   generations = max(generations, 0L);
+   population = max(population, (size_t) 2);
+   size_t elite = max(population / 8, (size_t) 1);
+
+   vector<HashParams> members(population, start);
+   for (size_t i = 1; i < population; i++)
+      if (i % 2)
+         for (unsigned int steps = 1 + random() % 8; steps > 0; steps--)
+            members[i] = neighbour(members[i], random);
+      else
+         members[i].multiplier = random();
+   vector<double> energies;
+   energy(members, energies);
+
+   EvolveResult result;
+   result.generations = 0;
+   result.evaluations = population;
+   vector<size_t> order(population);
+   vector<HashParams> children;
+   vector<double> childEnergies;
+   for (long g = 0; ; g++)
+   {
+      for (size_t i = 0; i < population; i++)
+         order[i] = i;
+      stable_sort(order.begin(), order.end(), [&energies](size_t x, size_t y)
+      {
+         return energies[x] < energies[y];
+      });
+      vector<HashParams> sorted(population);
+      vector<double> sortedEnergies(population);
+      for (size_t i = 0; i < population; i++)
+      {
+         sorted[i] = members[order[i]];
+         sortedEnergies[i] = energies[order[i]];
+      }
+      members.swap(sorted);
+      energies.swap(sortedEnergies);
+      if (g == generations)
+         break;
+
+      ScopedTimer timer(PHASE_ANNEAL_STEP, 1);
+      children.clear();
+      for (size_t i = elite; i < population; i++)
+         children.push_back(child(members));
+      energy(children, childEnergies);
+      for (size_t i = elite; i < population; i++)
+      {
+         members[i] = children[i - elite];
+         energies[i] = childEnergies[i - elite];
+      }
+      result.generations++;
+      result.evaluations += children.size();
+   }
+
+   result.best = members[0];
+   result.bestEnergy = energies[0];
+   result.wordsHashed = result.evaluations * (long) energy.size();
+   return result;
+}
+}
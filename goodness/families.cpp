@@ -0,0 +1,511 @@
+/*************************************************************************
+ * Hash families
+ *
+ * The hash family kernels and their registry; see goodness/families.h.
+ *************************************************************************/
+#include "goodness/families.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+using namespace std;
+
+namespace goodness
+{
+// hashCode before reduction: Java's String.hashCode
+uint64_t polyHash32(const char *data, size_t length, uint64_t)
+{
+   uint32_t h = 0;
+   for (size_t i = 0; i < length; i++)
+      h = 31 * h + data[i];
+   return h;
+}
+
+// the same polynomial carried in 64 bits
+uint64_t polyHash64(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = 0;
+   for (size_t i = 0; i < length; i++)
+      h = 31 * h + data[i];
+   return h;
+}
+
+// FNV-1a, 64-bit
+uint64_t fnv1aHash64(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = 0xcbf29ce484222325ULL;
+   for (size_t i = 0; i < length; i++)
+      h = (h ^ (unsigned char) data[i]) * 0x100000001b3ULL;
+   return h;
+}
+
+// add-multiply per byte with a final avalanche
+uint64_t multiplyHash64(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = length * 0x9e3779b97f4a7c15ULL;
+   for (size_t i = 0; i < length; i++)
+      h = (h + (unsigned char) data[i]) * 0xff51afd7ed558ccdULL;
+   return mix64(h);
+}
+
+// foldMultiply per byte
+uint64_t foldHash64(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = 0x2d358dccaa6c78a5ULL ^ length;
+   for (size_t i = 0; i < length; i++)
+      h = foldMultiply(h ^ (unsigned char) data[i], 0x8bb84b93962eacc9ULL);
+   return foldMultiply(h, 0x4b33a62ed433d4a3ULL);
+}
+
+const uint64_t CLMUL_KEY = 0xc2b2ae3d27d4eb4fULL;
+
+bool cpuHasCrc32()
+{
+#ifdef HAVE_X86_KERNELS
+   static const bool has = __builtin_cpu_supports("sse4.2");
+   return has;
+#else
+   return false;
+#endif
+}
+
+bool cpuHasClmul()
+{
+#ifdef HAVE_X86_KERNELS
+   static const bool has = __builtin_cpu_supports("pclmul");
+   return has;
+#else
+   return false;
+#endif
+}
+
+uint64_t loadTail(const char *data, size_t length)
+{
+   uint64_t word = 0;
+   memcpy(&word, data, length);
+   return word;
+}
+
+uint64_t crc32cSoft(const char *data, size_t length, uint64_t)
+{
+   // a function-local static is built once, safely, by the first thread
+   static const array<uint32_t, 256> table = []()
+   {
+      array<uint32_t, 256> bytes;
+      for (uint32_t i = 0; i < 256; i++)
+      {
+         uint32_t crc = i;
+         for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+         bytes[i] = crc;
+      }
+      return bytes;
+   }();
+
+   uint32_t crc = 0xffffffff;
+   for (size_t i = 0; i < length; i++)
+      crc = (crc >> 8) ^ table[(crc ^ (unsigned char) data[i]) & 0xff];
+   return ~crc;
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse4.2")))
+uint64_t crc32cHardware(const char *data, size_t length, uint64_t)
+{
+   uint64_t crc = 0xffffffff;
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      crc = _mm_crc32_u64(crc, word);
+   }
+   uint32_t crc32 = crc;
+   for (; i < length; i++)
+      crc32 = _mm_crc32_u8(crc32, data[i]);
+   return (uint32_t) ~crc32;
+}
+#endif
+
+uint64_t crc32cHash(const char *data, size_t length, uint64_t seed)
+{
+#ifdef HAVE_X86_KERNELS
+   if (cpuHasCrc32())
+      return crc32cHardware(data, length, seed);
+#endif
+   return crc32cSoft(data, length, seed);
+}
+
+// carry-less 64x64 -> 128 multiply, folded to 64 bits
+uint64_t clmulFoldSoft(uint64_t a, uint64_t b)
+{
+   uint64_t low = 0, high = 0;
+   for (int i = 0; i < 64; i++)
+      if ((b >> i) & 1)
+      {
+         low ^= a << i;
+         if (i > 0)
+            high ^= a >> (64 - i);
+      }
+   return low ^ high;
+}
+
+uint64_t clmulHashSoft(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = 0x9e3779b97f4a7c15ULL ^ length;
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      h = clmulFoldSoft(h ^ word, CLMUL_KEY);
+   }
+   if (i < length)
+      h = clmulFoldSoft(h ^ loadTail(data + i, length - i), CLMUL_KEY);
+   return mix64(h);
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("pclmul,sse2")))
+uint64_t clmulFoldHardware(uint64_t a, uint64_t b)
+{
+   __m128i product = _mm_clmulepi64_si128(_mm_cvtsi64_si128(a),
+                                          _mm_cvtsi64_si128(b), 0x00);
+   return (uint64_t) _mm_cvtsi128_si64(product) ^
+          (uint64_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(product, product));
+}
+
+__attribute__((target("pclmul,sse2")))
+uint64_t clmulHashHardware(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = 0x9e3779b97f4a7c15ULL ^ length;
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      h = clmulFoldHardware(h ^ word, CLMUL_KEY);
+   }
+   if (i < length)
+      h = clmulFoldHardware(h ^ loadTail(data + i, length - i), CLMUL_KEY);
+   return mix64(h);
+}
+#endif
+
+uint64_t clmulHash(const char *data, size_t length, uint64_t seed)
+{
+#ifdef HAVE_X86_KERNELS
+   if (cpuHasClmul())
+      return clmulHashHardware(data, length, seed);
+#endif
+   return clmulHashSoft(data, length, seed);
+}
+
+const uint32_t POW31[9] = { 1u, 31u, 961u, 29791u, 923521u, 28629151u,
+                            887503681u, 1742810335u, 2487512833u };
+
+uint32_t polyStep8(uint32_t h, uint64_t word)
+{
+   h *= POW31[8];
+   for (int i = 0; i < 8; i++)
+      h += (uint32_t) (int8_t) (word >> (8 * i)) * POW31[7 - i];
+   return h;
+}
+
+// the first `length` (< 8) bytes at data, in the low bytes of a word,
+// from at most three loads that stay inside them
+uint64_t loadShort(const char *data, size_t length)
+{
+   if (length >= 4)
+   {
+      uint32_t low, high;
+      memcpy(&low, data, 4);
+      memcpy(&high, data + length - 4, 4);
+      return low | (uint64_t) high << (8 * (length - 4));
+   }
+   if (length == 0)
+      return 0;
+   return (uint64_t) (unsigned char) data[0] |
+          (uint64_t) (unsigned char) data[length / 2] << (8 * (length / 2)) |
+          (uint64_t) (unsigned char) data[length - 1] << (8 * (length - 1));
+}
+
+// the low `length` (< 8) bytes of word moved to the top, the rest zero,
+// where polyStep8 weighs them 31^(length-1) down to 1; shifting in two
+// steps keeps length 0 defined
+uint64_t topBytes(uint64_t word, size_t length)
+{
+   return (word << 1) << (63 - 8 * length);
+}
+
+// the last `length` (< 8) bytes folded into h without a loop: the tail
+// word's missing leading bytes are zero, so they add nothing
+uint32_t polyTail(uint32_t h, uint64_t tail, size_t length)
+{
+   return h * POW31[length] + polyStep8(0, tail);
+}
+
+uint64_t polyHash32Wide(const char *data, size_t length, uint64_t)
+{
+   uint32_t h = 0;
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      h = polyStep8(h, word);
+   }
+
+   // the tail is the top of the word ending the key when that is at
+   // least a word long, with the bytes already hashed masked off
+   size_t rest = length - i;
+   uint64_t tail;
+   if (length >= 8)
+   {
+      memcpy(&tail, data + length - 8, 8);
+      tail &= topBytes(~0ULL, rest);
+   }
+   else
+      tail = topBytes(loadShort(data, length), length);
+   return polyTail(h, tail, rest);
+}
+
+uint64_t polyHash32Padded(const char *data, size_t length, uint64_t)
+{
+   uint32_t h = 0;
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      h = polyStep8(h, word);
+   }
+   uint64_t word;
+   memcpy(&word, data + i, 8);
+   return polyTail(h, topBytes(word, length - i), length - i);
+}
+
+uint64_t wordHash64(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = 0x2d358dccaa6c78a5ULL ^ length;
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      h = foldMultiply(h ^ word, 0x8bb84b93962eacc9ULL);
+   }
+   if (i < length)
+      h = foldMultiply(h ^ loadTail(data + i, length - i),
+                       0x8bb84b93962eacc9ULL);
+   return foldMultiply(h, 0x4b33a62ed433d4a3ULL);
+}
+
+uint64_t wordHash64Padded(const char *data, size_t length, uint64_t)
+{
+   uint64_t h = 0x2d358dccaa6c78a5ULL ^ length;
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      h = foldMultiply(h ^ word, 0x8bb84b93962eacc9ULL);
+   }
+   if (i < length)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      word &= ~0ULL >> (64 - 8 * (length - i));
+      h = foldMultiply(h ^ word, 0x8bb84b93962eacc9ULL);
+   }
+   return foldMultiply(h, 0x4b33a62ed433d4a3ULL);
+}
+
+uint64_t rotateLeft(uint64_t x, int bits)
+{
+   return (x << bits) | (x >> (64 - bits));
+}
+
+void sipRounds(uint64_t v[4], int rounds)
+{
+   for (int r = 0; r < rounds; r++)
+   {
+      v[0] += v[1]; v[1] = rotateLeft(v[1], 13); v[1] ^= v[0];
+      v[0] = rotateLeft(v[0], 32);
+      v[2] += v[3]; v[3] = rotateLeft(v[3], 16); v[3] ^= v[2];
+      v[0] += v[3]; v[3] = rotateLeft(v[3], 21); v[3] ^= v[0];
+      v[2] += v[1]; v[1] = rotateLeft(v[1], 17); v[1] ^= v[2];
+      v[2] = rotateLeft(v[2], 32);
+   }
+}
+
+uint64_t sipHash(const char *data, size_t length, uint64_t k0, uint64_t k1,
+                 int compressionRounds, int finalRounds)
+{
+   uint64_t v[4] = { 0x736f6d6570736575ULL ^ k0, 0x646f72616e646f6dULL ^ k1,
+                     0x6c7967656e657261ULL ^ k0, 0x7465646279746573ULL ^ k1 };
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      v[3] ^= word;
+      sipRounds(v, compressionRounds);
+      v[0] ^= word;
+   }
+   uint64_t last = (uint64_t) length << 56 | loadTail(data + i, length - i);
+   v[3] ^= last;
+   sipRounds(v, compressionRounds);
+   v[0] ^= last;
+   v[2] ^= 0xff;
+   sipRounds(v, finalRounds);
+   return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+uint64_t sipHash13(const char *data, size_t length, uint64_t seed)
+{
+   return sipHash(data, length, seed, mix64(seed), 1, 3);
+}
+
+// the multilinear keys: the first MULTILINEAR_CACHED are kept per
+// thread for the last seed, the rest made as needed
+const size_t MULTILINEAR_CACHED = 66;
+
+uint64_t multilinearKey(uint64_t seed, size_t i)
+{
+   return mix64(seed + (i + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+uint64_t multiShiftHash32(const char *data, size_t length, uint64_t seed)
+{
+   thread_local uint64_t keys[MULTILINEAR_CACHED];
+   thread_local uint64_t keysSeed = 0;
+   thread_local bool keysMade = false;
+   if (!keysMade || keysSeed != seed)
+   {
+      for (size_t k = 0; k < MULTILINEAR_CACHED; k++)
+         keys[k] = multilinearKey(seed, k);
+      keysSeed = seed;
+      keysMade = true;
+   }
+
+   // keys[0] plus each 32-bit piece (zero padded, then the length)
+   // times its own key
+   uint64_t h = keys[0];
+   size_t k = 1;
+   for (size_t i = 0; i < length; i += 8, k += 2)
+   {
+      uint64_t word = loadTail(data + i, min<size_t>(length - i, 8));
+      uint64_t low = k < MULTILINEAR_CACHED ? keys[k]
+                   : multilinearKey(seed, k);
+      uint64_t high = k + 1 < MULTILINEAR_CACHED ? keys[k + 1]
+                    : multilinearKey(seed, k + 1);
+      h += low * (uint32_t) word + high * (word >> 32);
+   }
+   h += (k < MULTILINEAR_CACHED ? keys[k] : multilinearKey(seed, k)) *
+        (uint32_t) length;
+   return h >> 32;
+}
+
+const uint64_t WY_SECRET[2] = { 0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL };
+
+uint64_t load32(const char *data)
+{
+   uint32_t word;
+   memcpy(&word, data, 4);
+   return word;
+}
+
+uint64_t wyHash64(const char *data, size_t length, uint64_t seed)
+{
+   seed ^= foldMultiply(seed ^ WY_SECRET[0], WY_SECRET[1]);
+   uint64_t a = 0, b = 0;
+   if (length >= 4 && length <= 16)
+   {
+      // four overlapping 32-bit loads cover every length from 4 to 16
+      size_t step = (length >> 3) << 2;
+      a = load32(data) << 32 | load32(data + step);
+      b = load32(data + length - 4) << 32 | load32(data + length - 4 - step);
+   }
+   else if (length > 0 && length < 4)
+      a = (uint64_t) (unsigned char) data[0] << 16 |
+          (uint64_t) (unsigned char) data[length >> 1] << 8 |
+          (unsigned char) data[length - 1];
+   else if (length > 16)
+   {
+      size_t i = 0;
+      for (; length - i > 16; i += 16)
+      {
+         uint64_t first, second;
+         memcpy(&first, data + i, 8);
+         memcpy(&second, data + i + 8, 8);
+         seed = foldMultiply(first ^ WY_SECRET[1], second ^ seed);
+      }
+      memcpy(&a, data + length - 16, 8);
+      memcpy(&b, data + length - 8, 8);
+   }
+
+   unsigned __int128 product = (unsigned __int128) (a ^ WY_SECRET[1]) *
+                               (b ^ seed);
+   return foldMultiply((uint64_t) product ^ WY_SECRET[0] ^ length,
+                       (uint64_t) (product >> 64) ^ WY_SECRET[1]);
+}
+
+uint64_t processSeed()
+{
+   static const uint64_t seed = []()
+   {
+      random_device device;
+      uint64_t bits = (uint64_t) device() << 32 | device();
+      // in case random_device is deterministic on this platform
+      bits ^= chrono::high_resolution_clock::now().time_since_epoch().count();
+      return mix64(bits);
+   }();
+   return seed;
+}
+
+const HashFamily hashFamilies[] =
+{
+   { "poly32",       32, polyHash32,       false },
+   { "poly64",       64, polyHash64,       false },
+   { "fnv1a64",      64, fnv1aHash64,      false },
+   { "mult64",       64, multiplyHash64,   false },
+   { "fold64",       64, foldHash64,       false },
+   { "crc32c",       32, crc32cHash,       false },
+   { "crc32c-soft",  32, crc32cSoft,       false },
+   { "clmul64",      64, clmulHash,        false },
+   { "clmul64-soft", 64, clmulHashSoft,    false },
+   { "poly32-wide",  32, polyHash32Wide,   false },
+   { "word64",       64, wordHash64,       false },
+   { "siphash13",    64, sipHash13,        true },
+   { "multishift32", 32, multiShiftHash32, true },
+   { "wyhash64",     64, wyHash64,         true },
+};
+const size_t numHashFamilies = sizeof(hashFamilies) / sizeof(hashFamilies[0]);
+
+// versions of families above that need PaddedCorpus storage
+const HashFamily paddedHashFamilies[] =
+{
+   { "poly32-wide",  32, polyHash32Padded, false },
+   { "word64",       64, wordHash64Padded, false },
+};
+const size_t numPaddedHashFamilies =
+   sizeof(paddedHashFamilies) / sizeof(paddedHashFamilies[0]);
+
+const HashFamily *findHashFamily(const string &name)
+{
+   for (size_t i = 0; i < numHashFamilies; i++)
+      if (name == hashFamilies[i].name)
+         return &hashFamilies[i];
+   return NULL;
+}
+}
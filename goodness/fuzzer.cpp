@@ -0,0 +1,31 @@
+/*************************************************************************
+ * Program:
+ *    goodness-fuzz -- libFuzzer entry point
+ *
+ * Summary:
+ *    Coverage-guided differential fuzzing of the hash kernels: every
+ *    input libFuzzer generates is run through kernelMismatch, and any
+ *    disagreement aborts so libFuzzer saves the input.  Built only with
+ *    -DGOODNESS_FUZZER=ON (Clang).  Replay a saved input without Clang
+ *    with "goodness replay=FILE fuzz".
+ *************************************************************************/
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "goodness/differential.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+   // seed 1, the default of "goodness fuzz", so replays agree
+   std::string mismatch = goodness::kernelMismatch((const char *) data, size,
+                                                   1);
+   if (!mismatch.empty())
+   {
+      fprintf(stderr, "kernel mismatch at %zu bytes: %s\n", size,
+              mismatch.c_str());
+      abort();
+   }
+   return 0;
+}
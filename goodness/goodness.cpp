@@ -8,7 +8,7 @@
  * Summary:
  *    A program to experiment with Simulated Annealing.
  *************************************************************************/
-#if 0
+/*
 The simulated annealing algorithm, courtesy The Web:
 ----------------------------------------------------------------------------
 1. Choose an initial state (random numbers?)
@@ -51,168 +51,2290 @@ fraction r of the time budget that has been expended so far.
 
 P(e, enew, T) = 1 if enew < e, exp(-(enew - e)/T) otherwise
 ----------------------------------------------------------------------------
-#endif
+*/
 
-#include <cassert>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <vector>
 #include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
 
-#define HASH_SIZE 1048576
+#include "goodness/goodness.h"
 
 using namespace std;
+using namespace goodness;
+
+/*************************************************************************
+ * options
+ *
+ * Settings given on the command line as name=value, read by the tests
+ * that follow them (e.g. "goodness reps=50 bench").
+ *************************************************************************/
+map<string, string> options;
+
+string option(const string &name, const string &fallback)
+{
+   map<string, string>::iterator it = options.find(name);
+   return it == options.end() ? fallback : it->second;
+}
+
+long intOption(const string &name, long fallback)
+{
+   map<string, string>::iterator it = options.find(name);
+   return it == options.end() ? fallback : atol(it->second.c_str());
+}
 
-/**********************************************************************
- * toUnsignedString
- *  makes its integer argument into a 32-character bitstring (0s or 1s)
- *  useful for debugging. 
- *********************************************************************/
-string toUnsignedString(unsigned int i)
-{
-   char buf[32];
-   int charPos = 32;
-   int shift = 1;
-   int radix = 1 << shift;
-   int mask = radix - 1;
-   do
+// a seed for the keyed hash families: the option's value, or with
+// name=random a new one every run (processSeed), as production would do
+uint64_t seedOption(const string &name, uint64_t fallback)
+{
+   if (option(name, "") == "random")
+      return processSeed();
+   return intOption(name, fallback);
+}
+
+// the "threads" option, every core by default; 0, after an error, if
+// it is not at least 1
+int threadsOption()
+{
+   long threads = intOption("threads",
+                            max(1u, thread::hardware_concurrency()));
+   if (threads < 1)
    {
-      buf[--charPos] = '0' + (i & mask);
-      i >>= shift;
+      cerr << "threads must be at least 1" << endl;
+      return 0;
    }
-   while (i != 0);
-   while (charPos > 0)
-      buf[--charPos] = '0';
-   return string(buf, 32);
+   return threads;
 }
 
 /*************************************************************************
- * hash
- * 
- *
- *************************************************************************/
-int safteyHash(unsigned int h)
-{
-    // This function ensures that hashCodes that differ only by
-    // constant multiples at each bit position have a bounded
-    // number of collisions (approximately 8 at default load factor).
-    h = h ^ (h >> 20) ^ (h >> 12);
-    return h ^ (h >> 7) ^ (h >> 4);
-}
-
-/**********************************************************************
- * hashCode
- *    returns an integer value of a string.
- *    works like Java's String.hashCode(), which is computed as 
- *
- *    s[0] * 31^(n-1) + s[1] * 31^(n-2) + ... + s[n-1]
- *
- *    using int arithmetic, where s[i] is the i'th character
- *    of the string, n is the length of the string,
- *    and ^ indicates exponentiation.
- *    (The hash value of the empty string is zero.)
- *********************************************************************/
-unsigned int hashCode(string &word)
-{
-   unsigned int h = 0;
-   for (int i = 0; i < word.length(); i++)
-   {
-      h = 31 * h + word[i]; // GOOD
-   }
-    
-   return h % HASH_SIZE;
-}
-
-/*************************************************************************
- * calcEnergy
- *
- * Get the hash code of each word in the file and output as 'hashed'
- *************************************************************************/
-double calcEnergy(string filename)
-{
-    //open the file
-    ifstream fin(filename.c_str());
-    
-    if (fin.fail())
-        return -1;
-
-    map<int,int> collisionRecord;
-    
-    int temp;
-    
-    //for each value in the file
-    while (fin >> temp)
-    {
-        //if the map does not contains the key
-        if(collisionRecord.count(temp) == 0)
-            collisionRecord[temp] = 0;
-        else
-        {
-            //if there was a collision, apply the secondary hash
-            temp = safteyHash(temp);
-            
-            if(collisionRecord.count(temp) == 0)
-                collisionRecord[temp] = 0;
-            else
-                collisionRecord[temp] =  collisionRecord[temp] + 1;
-        }
-    }
-    
-    fin.close();
-    
-    //calculate the average
-    double average = 0;
-    
-    typedef map<int, int>::iterator it_type;
-    for(it_type iterator = collisionRecord.begin(); iterator != collisionRecord.end(); iterator++)
-    {
-        average += iterator->second;
-    }
-    
-    average /= (double) collisionRecord.size();
-
-    //return the average collisions
-    return average;
+ * loadCorpus
+ *
+ * The corpus a test runs on: generated in memory when the "generate"
+ * option names a kind (with "count" and "seed"), otherwise read from the
+ * file named by the "words" option.
+ *************************************************************************/
+Corpus loadCorpus()
+{
+   Corpus corpus;
+   string kind = option("generate", "");
+   if (kind.empty())
+   {
+      string file = option("words", "words");
+      if (corpus.load(file))
+         return corpus;
+      // nothing of a file that could not be read is scored
+      cerr << "Error reading file " << file << endl;
+      return Corpus();
+   }
+
+   CorpusGenerator generator(kind, intOption("count", 1000000),
+                             intOption("seed", 1));
+   if (!generator.valid())
+   {
+      cerr << "Unknown corpus kind: " << kind << endl;
+      return corpus;
+   }
+   ScopedTimer timer(PHASE_LOAD, intOption("count", 1000000));
+   corpus.reserve(intOption("count", 1000000));
+   while (!generator.done())
+      corpus.add(generator.next());
+   return corpus;
 }
 
 /*************************************************************************
- * hashFile
+ * scoredWords
  *
- * Get the hash code of each word in the file and output as 'hashed'
+ * The words a test scores: every word of the corpus, or with the
+ * option distinct=1 each distinct word once, so duplicated input words
+ * are not counted as collisions.
  *************************************************************************/
-void hashFile(string file)
+const vector<string_view> &scoredWords(const Corpus &corpus)
 {
-    ifstream fin(file.c_str());
-    ofstream fout("hashed");
-    
-    if (fin.fail() || fout.fail())
-    {
-        cerr << "Error reading file";
-        return;
-    }
-    
-    string word;
-    while (fin >> word)
-    {
-        fout << hashCode(word) << endl;
-    }
-    
-    fin.close();
-    fout.close();
+   return intOption("distinct", 0) ? corpus.distinctWords() : corpus.words();
 }
 
 /*************************************************************************
- * runOne
+ * runGenerate
  *
- * Runs one test.
+ * Streams a synthetic corpus straight to a binary corpus file without
+ * holding it in memory.
  *************************************************************************/
-void runOne(string test)
+void runGenerate()
+{
+   string kind = option("generate", option("kind", "random"));
+   unsigned long long count = intOption("count", 1000000);
+   string out = option("out", "corpus.bin");
+
+   CorpusGenerator generator(kind, count, intOption("seed", 1));
+   if (!generator.valid())
+   {
+      cerr << "Unknown corpus kind: " << kind << endl;
+      return;
+   }
+
+   ofstream fout(out.c_str(), ios::binary);
+   if (fout.fail())
+   {
+      cerr << "Error writing " << out << endl;
+      return;
+   }
+   writeCorpusHeader(fout, count);
+   while (!generator.done())
+      writeCorpusWord(fout, generator.next());
+   cout << "Wrote " << count << " " << kind << " words to " << out << endl;
+}
+
+/*************************************************************************
+ * Benchmark support
+ *
+ * A benchmark body is run `warmup` times untimed, then `reps` times
+ * timed; each timed repetition yields one sample in nanoseconds.
+ * Results are printed as a table and appended to a CSV file so runs
+ * of different builds can be compared.
+ *************************************************************************/
+volatile unsigned int benchSink;   // keeps the optimizer from eliding work
+
+struct BenchResult
+{
+   string name;
+   string unit;
+   double median;
+   double p95;
+   int reps;
+};
+
+/*************************************************************************
+ * percentile
+ *
+ * Nearest-rank percentile of a set of samples (p in [0, 100]).
+ *************************************************************************/
+double percentile(vector<double> samples, double p)
+{
+   if (samples.empty())
+      return 0;
+   sort(samples.begin(), samples.end());
+   size_t rank = (size_t)ceil(p / 100.0 * samples.size());
+   if (rank > 0)
+      rank--;
+   return samples[min(rank, samples.size() - 1)];
+}
+
+/*************************************************************************
+ * summarize
+ *
+ * Turns raw per-repetition samples into a result, dividing each sample
+ * by `per` so that results are reported per word / per call.
+ *************************************************************************/
+BenchResult summarize(string name, string unit, vector<double> samples,
+                      double per)
+{
+   for (size_t i = 0; i < samples.size(); i++)
+      samples[i] /= per;
+
+   BenchResult result;
+   result.name = name;
+   result.unit = unit;
+   result.median = percentile(samples, 50);
+   result.p95 = percentile(samples, 95);
+   result.reps = samples.size();
+   return result;
+}
+
+/*************************************************************************
+ * benchHashCode
+ *
+ * Times hashCode over every word of one length bucket.
+ *************************************************************************/
+BenchResult benchHashCode(string name, vector<string> &words,
+                          int warmup, int reps)
+{
+   vector<double> samples;
+   for (int rep = -warmup; rep < reps; rep++)
+   {
+      Clock::time_point start = Clock::now();
+      unsigned int sink = 0;
+      for (size_t i = 0; i < words.size(); i++)
+         sink += hashCode(words[i]);
+      double elapsed = nanosSince(start);
+      benchSink += sink;
+      if (rep >= 0)
+         samples.push_back(elapsed);
+   }
+   return summarize(name, "ns/word", samples, max<size_t>(words.size(), 1));
+}
+
+/*************************************************************************
+ * benchBucketHash
+ *
+ * Times hashing the whole corpus lane-parallel from LengthBuckets.
+ *************************************************************************/
+BenchResult benchBucketHash(const vector<string_view> &words, int warmup,
+                            int reps)
+{
+   LengthBuckets buckets(words);
+   HashParams params;
+   vector<unsigned int> hashes;
+   vector<uint32_t> lanes;
+   vector<double> samples;
+   for (int rep = -warmup; rep < reps; rep++)
+   {
+      Clock::time_point start = Clock::now();
+      buckets.hashAll(params, hashes, lanes);
+      double elapsed = nanosSince(start);
+      benchSink += hashes.empty() ? 0 : hashes[0];
+      if (rep >= 0)
+         samples.push_back(elapsed);
+   }
+   return summarize("hashCode[buckets]", "ns/word", samples,
+                    max<size_t>(words.size(), 1));
+}
+
+/*************************************************************************
+ * benchSafteyHash
+ *
+ * Times safteyHash over an array of hash codes.
+ *************************************************************************/
+BenchResult benchSafteyHash(vector<unsigned int> &codes, int warmup, int reps)
+{
+   vector<double> samples;
+   for (int rep = -warmup; rep < reps; rep++)
+   {
+      Clock::time_point start = Clock::now();
+      unsigned int sink = 0;
+      for (size_t i = 0; i < codes.size(); i++)
+         sink += safteyHash(codes[i]);
+      double elapsed = nanosSince(start);
+      benchSink += sink;
+      if (rep >= 0)
+         samples.push_back(elapsed);
+   }
+   return summarize("safteyHash", "ns/call", samples,
+                    max<size_t>(codes.size(), 1));
+}
+
+/*************************************************************************
+ * benchCalcEnergy
+ *
+ * Times one full calcEnergy evaluation of a hashed file.
+ *************************************************************************/
+BenchResult benchCalcEnergy(string hashed, int warmup, int reps)
+{
+   vector<double> samples;
+   for (int rep = -warmup; rep < reps; rep++)
+   {
+      Clock::time_point start = Clock::now();
+      double energy = calcEnergy(hashed);
+      double elapsed = nanosSince(start);
+      benchSink += (unsigned int)(energy * 1e6);
+      if (rep >= 0)
+         samples.push_back(elapsed);
+   }
+   return summarize("calcEnergy", "ms/eval", samples, 1e6);
+}
+
+/*************************************************************************
+ * reportBench
+ *
+ * Prints the results as a table and appends them, one CSV row each,
+ * to the file named by the "out" option.
+ *************************************************************************/
+void reportBench(vector<BenchResult> &results)
+{
+   cout << left << setw(20) << "benchmark" << right
+        << setw(12) << "median" << setw(12) << "p95"
+        << "  unit" << endl;
+   for (size_t i = 0; i < results.size(); i++)
+   {
+      cout << left << setw(20) << results[i].name << right << fixed
+           << setprecision(3)
+           << setw(12) << results[i].median
+           << setw(12) << results[i].p95
+           << "  " << results[i].unit << endl;
+   }
+   cout.unsetf(ios::fixed);
+
+   string out = option("out", "bench.csv");
+   ifstream existing(out.c_str());
+   bool header = !existing.good();
+   existing.close();
+
+   ofstream fout(out.c_str(), ios::app);
+   if (fout.fail())
+   {
+      cerr << "Error writing " << out << endl;
+      return;
+   }
+   if (header)
+      fout << "benchmark,unit,reps,median,p95" << endl;
+   for (size_t i = 0; i < results.size(); i++)
+      fout << results[i].name << ',' << results[i].unit << ','
+           << results[i].reps << ',' << results[i].median << ','
+           << results[i].p95 << endl;
+}
+
+/*************************************************************************
+ * runBench
+ *
+ * Micro-benchmarks hashCode (per word-length bucket), safteyHash and
+ * calcEnergy on the words file.
+ *************************************************************************/
+void runBench()
+{
+   int warmup = intOption("warmup", 3);
+   int reps = intOption("reps", 21);
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = corpus.words();
+   if (words.empty())
+      return;
+
+   // bucket the words by length: 1-4, 5-8, 9-12, 13-16, 17+
+   const char *names[] = { "hashCode[1-4]", "hashCode[5-8]",
+                           "hashCode[9-12]", "hashCode[13-16]",
+                           "hashCode[17+]" };
+   vector<string> strings(words.begin(), words.end());
+   vector<string> buckets[5];
+   for (size_t i = 0; i < strings.size(); i++)
+      buckets[min<size_t>((max<size_t>(strings[i].length(), 1) - 1) / 4, 4)]
+         .push_back(strings[i]);
+
+   vector<BenchResult> results;
+   results.push_back(benchHashCode("hashCode[all]", strings, warmup, reps));
+   results.push_back(benchBucketHash(words, warmup, reps));
+   for (int b = 0; b < 5; b++)
+      if (!buckets[b].empty())
+         results.push_back(benchHashCode(names[b], buckets[b], warmup, reps));
+
+   vector<unsigned int> codes(words.size());
+   for (size_t i = 0; i < strings.size(); i++)
+      codes[i] = hashCode(strings[i]);
+   results.push_back(benchSafteyHash(codes, warmup, reps));
+
+   // a file of its own, so the checked-in "hashed" fixture is left as
+   // it is when this runs on another corpus
+   ofstream hashed("bench-hashed.tmp");
+   for (size_t i = 0; i < words.size(); i++)
+      hashed << codes[i] << endl;
+   hashed.close();
+   results.push_back(benchCalcEnergy("bench-hashed.tmp", min(warmup, 1),
+                                     intOption("energyReps", 5)));
+   remove("bench-hashed.tmp");
+
+   reportBench(results);
+}
+
+// a ratio of counts for display, "n/a" if either count is missing
+string perfRatio(double count, double per, int precision)
+{
+   if (count < 0 || per <= 0)
+      return "n/a";
+   ostringstream out;
+   out << fixed << setprecision(precision) << count / per;
+   return out.str();
+}
+
+/*************************************************************************
+ * runPerf
+ *
+ * Hardware counters around hashCode over the corpus, one in-memory
+ * energy evaluation, calcEnergy on a temporary hashed file written
+ * from the same words, and an annealing run: IPC, and cache and branch misses per
+ * word processed.
+ *************************************************************************/
+void runPerf()
+{
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   PerfCounters counters;
+   if (!counters.open())
+   {
+      cerr << "perf_event_open is not available: " << strerror(errno)
+           << endl;
+      return;
+   }
+
+   vector<string> strings(words.begin(), words.end());
+   Histogram histogram;
+   long steps = intOption("steps", 10);
+
+   // calcEnergy reads its codes from a file, so write them from the
+   // words loaded here, as runBench does, before anything is counted
+   ofstream hashed("perf-hashed.tmp");
+   for (size_t i = 0; i < strings.size(); i++)
+      hashed << hashCode(strings[i]) << endl;
+   hashed.close();
+
+   cout << left << setw(14) << "section" << right << setw(14) << "words"
+        << setw(8) << "IPC" << setw(12) << "cycles/w"
+        << setw(12) << "L1D miss/w" << setw(12) << "LLC miss/w"
+        << setw(12) << "br miss/w" << endl;
+
+   for (int section = 0; section < 4; section++)
+   {
+      const char *name = "";
+      double processed = words.size();
+      counters.start();
+      if (section == 0)
+      {
+         name = "hashCode";
+         unsigned int sink = 0;
+         for (size_t i = 0; i < strings.size(); i++)
+            sink += hashCode(strings[i]);
+         benchSink += sink;
+      }
+      else if (section == 1)
+      {
+         name = "energyOf";
+         benchSink += energyOf(HashParams(), words, histogram) > 0;
+      }
+      else if (section == 2)
+      {
+         name = "calcEnergy";
+         if (calcEnergy("perf-hashed.tmp") < 0)
+            processed = 0;
+      }
+      else
+      {
+         name = "anneal";
+         AnnealResult result = anneal(words, steps, intOption("seed", 1));
+         processed = result.wordsHashed;
+      }
+      vector<double> counts = counters.stop();
+      if (processed == 0)
+         continue;
+
+      cout << left << setw(14) << name << right
+           << setw(14) << (long) processed
+           << setw(8) << perfRatio(counts[PERF_INSTRUCTIONS],
+                                   counts[PERF_CYCLES], 2)
+           << setw(12) << perfRatio(counts[PERF_CYCLES], processed, 2)
+           << setw(12) << perfRatio(counts[PERF_L1D_MISSES], processed, 4)
+           << setw(12) << perfRatio(counts[PERF_LLC_MISSES], processed, 4)
+           << setw(12) << perfRatio(counts[PERF_BRANCH_MISSES], processed, 4)
+           << endl;
+   }
+   remove("perf-hashed.tmp");
+}
+
+/*************************************************************************
+ * runCorpus
+ *
+ * Loads the corpus and reports its size, duplicates, memory footprint
+ * and load rate.
+ *************************************************************************/
+void runCorpus()
+{
+   Clock::time_point start = Clock::now();
+   Corpus corpus = loadCorpus();
+   double seconds = nanosSince(start) / 1e9;
+
+   cout << "Words: " << corpus.size() << endl;
+   cout << "Distinct: " << corpus.distinct() << endl;
+   cout << "Memory: " << corpus.bytes() / 1024 << " kB" << endl;
+   cout << "Load: " << seconds << " s ("
+        << corpus.size() / seconds << " words/s)" << endl;
+}
+
+/*************************************************************************
+ * runDedup
+ *
+ * Separates duplicated words from true hash collisions.
+ *************************************************************************/
+void runDedup()
+{
+   Corpus corpus = loadCorpus();
+   if (corpus.size() == 0)
+      return;
+
+   Histogram all, distinct;
+   DedupEnergy result = dedupEnergy(HashParams(), corpus, all, distinct);
+   cout << "Words: " << corpus.size() << " (" << corpus.distinct()
+        << " distinct, " << result.duplicates << " duplicates)" << endl;
+   cout << "Average number of collisions: " << result.energy << endl;
+   cout << "Average on distinct words: " << result.distinctEnergy << endl;
+   cout << "Collisions: " << result.collisions << " ("
+        << result.trueCollisions << " true, "
+        << result.collisions - result.trueCollisions
+        << " from duplicates)" << endl;
+}
+
+/*************************************************************************
+ * annealWords
+ *
+ * The annealing run of the anneal and emit tests: "steps" steps from
+ * "seed" with live progress.  adversarial=W adds W times
+ * adversarialPartners to every energy; the bestEnergy returned is
+ * still calcEnergy's alone.
+ *************************************************************************/
+AnnealResult annealWords(const vector<string_view> &words)
+{
+   vector<AnnealProgress> progress(1);
+   ProgressReporter reporter(progress, atof(option("progress", "5").c_str()),
+                             option("progressFile", ""));
+   Annealer annealer(words, intOption("seed", 1));
+   annealer.setProgress(&progress[0]);
+   double weight = atof(option("adversarial", "0").c_str());
+   annealer.setAdversarialWeight(weight);
+   AnnealResult result = annealer.run(intOption("steps", 1000));
+   reporter.stop();
+
+   if (weight > 0)
+   {
+      annealer.setAdversarialWeight(0);
+      result.bestEnergy = annealer.evaluate(result.best);
+   }
+   return result;
+}
+
+/*************************************************************************
+ * runAnneal
+ *
+ * Anneals the hash parameters on the words file and reports the best
+ * state found.
+ *************************************************************************/
+void runAnneal()
+{
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   AnnealResult result = annealWords(words);
+   cout << "Best: " << result.best << endl;
+   cout << "Average number of collisions: " << result.bestEnergy << endl;
+   if (options.count("adversarial"))
+      cout << "Adversarial partners: " << adversarialPartners(result.best, 3)
+           << " (default hash " << adversarialPartners(HashParams(), 3)
+           << ")" << endl;
+}
+
+/*************************************************************************
+ * runEvolve
+ *
+ * The genetic search (see Evolver) on the words file, with each
+ * generation scored on "threads" threads.  With compare=1 it then
+ * anneals for as many evaluations, as a baseline.
+ *************************************************************************/
+void runEvolve()
+{
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   int threads = threadsOption();
+   if (threads == 0)
+      return;
+   unsigned int seed = intOption("seed", 1);
+   double weight = atof(option("adversarial", "0").c_str());
+   long generations = intOption("generations", 50);
+   long population = intOption("population", 64);
+   if (generations < 0 || population < 2)
+   {
+      cerr << "generations must be at least 0 and population at least 2"
+           << endl;
+      return;
+   }
+   Evolver evolver(words, seed, threads);
+   evolver.setAdversarialWeight(weight);
+   Clock::time_point start = Clock::now();
+   EvolveResult result = evolver.run(generations, population);
+   double seconds = nanosSince(start) / 1e9;
+
+   EnergyFunction energy(words);
+   cout << "Best: " << result.best << endl;
+   cout << "Average number of collisions: " << energy(result.best) << endl;
+   if (options.count("adversarial"))
+      cout << "Adversarial partners: " << adversarialPartners(result.best, 3)
+           << " (default hash " << adversarialPartners(HashParams(), 3)
+           << ")" << endl;
+   cout << "Evaluations: " << result.evaluations << " in "
+        << result.generations << " generations, " << seconds << " s ("
+        << result.evaluations / seconds << " evals/s on " << threads
+        << " threads)" << endl;
+
+   if (!intOption("compare", 0))
+      return;
+   Annealer annealer(words, seed);
+   annealer.setAdversarialWeight(weight);
+   start = Clock::now();
+   AnnealResult annealed = annealer.run(result.evaluations - 1);
+   seconds = nanosSince(start) / 1e9;
+   cout << "Annealing, same evaluations: " << annealed.best << ", "
+        << energy(annealed.best) << " collisions, "
+        << annealed.evaluations / seconds << " evals/s" << endl;
+}
+
+/*************************************************************************
+ * runSweep
+ *
+ * Scores every point of a small space (space=multipliers: the odd
+ * multipliers below 2^bits; space=shifts: every value of the shifts
+ * listed in "vary") and reports the best "top", and where the base
+ * hash ranks among them.  The base is hashCode's constants unless
+ * "multiplier" or "shifts" (as 20/12/7/4) say otherwise.  Progress is
+ * kept in "checkpoint" after every batch, so running the same sweep
+ * again resumes it; a checkpoint of a different sweep stops the run
+ * unless discard=1.  "limit" stops after that many points.
+ *************************************************************************/
+double sweepInterval;
+Clock::time_point sweepStart, sweepReported;
+
+void reportSweep(const Sweep &sweep)
+{
+   if (sweepInterval <= 0 || nanosSince(sweepReported) < sweepInterval * 1e9)
+      return;
+   sweepReported = Clock::now();
+   vector<SweepEntry> top = sweep.top();
+   cerr << "[" << fixed << setprecision(1) << nanosSince(sweepStart) / 1e9
+        << "s] swept " << sweep.next << "/" << sweep.space.size()
+        << setprecision(7) << " best=" << (top.empty() ? 0 : top[0].energy)
+        << endl;
+   cerr.unsetf(ios::fixed);
+   cerr << setprecision(6);
+}
+
+void runSweep()
+{
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   HashParams base;
+   base.multiplier = intOption("multiplier", base.multiplier);
+   string shifts = option("shifts", "");
+   if (!shifts.empty() &&
+       sscanf(shifts.c_str(), "%d/%d/%d/%d", &base.shifts[0], &base.shifts[1],
+              &base.shifts[2], &base.shifts[3]) != 4)
+   {
+      cerr << "shifts must be four numbers, e.g. 20/12/7/4" << endl;
+      return;
+   }
+   for (int i = 0; i < 4; i++)
+      if (base.shifts[i] < 1 || base.shifts[i] > 31)
+      {
+         cerr << "shifts must be from 1 to 31" << endl;
+         return;
+      }
+
+   string kind = option("space", "multipliers");
+   SweepSpace space = SweepSpace::multipliers(intOption("bits", 16), base);
+   if (kind == "shifts")
+   {
+      string vary = option("vary", "01");
+      if (vary.empty() || vary.find_first_not_of("0123") != string::npos)
+      {
+         cerr << "vary must list shift positions 0 to 3, e.g. 01" << endl;
+         return;
+      }
+      vector<int> positions;
+      for (size_t i = 0; i < vary.length(); i++)
+         positions.push_back(vary[i] - '0');
+      space = SweepSpace::shifts(positions, base);
+   }
+   else if (kind != "multipliers")
+   {
+      cerr << "Unknown space: " << kind << endl;
+      return;
+   }
+
+   int threads = threadsOption();
+   if (threads == 0)
+      return;
+   BatchEnergy energy(words, threads);
+   vector<double> energies;
+   energy(vector<HashParams>(1, base), energies);
+   Sweep sweep(space, intOption("top", 10), energies[0]);
+
+   cout << "Space: " << space.name() << " (" << space.size() << " points)"
+        << endl;
+   // a checkpoint that is there but cannot be resumed is from another
+   // sweep (or damaged), and is only overwritten when asked to
+   string checkpoint = option("checkpoint", "sweep.checkpoint");
+   if (!checkpoint.empty() && ifstream(checkpoint.c_str()).good())
+   {
+      if (sweep.load(checkpoint))
+         cout << "Resuming " << checkpoint << " at " << sweep.next << endl;
+      else if (intOption("discard", 0))
+         cout << "Discarding " << checkpoint << endl;
+      else
+      {
+         cerr << checkpoint << " is from a different sweep; run with"
+              << " discard=1 to start over" << endl;
+         return;
+      }
+   }
+
+   uint64_t first = sweep.next;
+   sweepInterval = atof(option("progress", "5").c_str());
+   sweepStart = sweepReported = Clock::now();
+   if (!sweep.run(energy, intOption("limit", space.size()),
+                  intOption("batch", 256), checkpoint, reportSweep))
+      cerr << "Error writing " << checkpoint << endl;
+   double seconds = nanosSince(sweepStart) / 1e9;
+
+   cout << "Swept: " << sweep.next << "/" << space.size() << ", "
+        << sweep.next - first << " in " << seconds << " s ("
+        << (sweep.next - first) / seconds << " evals/s on " << threads
+        << " threads)" << (sweep.done() ? "" : ", run again to resume")
+        << endl;
+   vector<SweepEntry> top = sweep.top();
+   for (size_t i = 0; i < top.size(); i++)
+   {
+      ostringstream params;
+      params << space.at(top[i].index);
+      cout << setw(5) << i + 1 << "  " << left << setw(40) << params.str()
+           << right << setprecision(9) << top[i].energy << setprecision(6)
+           << endl;
+   }
+   cout << "Base: " << base << ", " << sweep.reference << ", "
+        << sweep.better << " points better" << endl;
+   if (!top.empty())
+   {
+      cout << "Best: " << space.at(top[0].index) << endl;
+      cout << "Average number of collisions: " << top[0].energy << endl;
+   }
+}
+
+/*************************************************************************
+ * runStream
+ *
+ * Computes the energy of the default hash on a corpus file without
+ * loading it, and reports the read and hash rate.
+ *************************************************************************/
+void runStream()
+{
+   string file = option("words", "words");
+   long chunkBytes = intOption("chunk", 8 << 20);
+   if (chunkBytes < 1)
+   {
+      cerr << "chunk must be at least 1 byte" << endl;
+      return;
+   }
+   Histogram histogram;
+
+   Clock::time_point start = Clock::now();
+   StreamResult result = streamEnergy(HashParams(), file, chunkBytes,
+                                      histogram);
+   double seconds = nanosSince(start) / 1e9;
+   if (result.energy < 0)
+   {
+      cerr << "Error reading file " << file << endl;
+      return;
+   }
+
+   cout << "Words: " << result.words << endl;
+   cout << "Average number of collisions: " << result.energy << endl;
+   cout << "Seconds: " << seconds << " ("
+        << result.bytes / seconds / 1e6 << " MB/s, "
+        << result.words / seconds << " words/s)" << endl;
+}
+
+/*************************************************************************
+ * runWide
+ *
+ * Full-width collisions of each hash family's unreduced output (or just
+ * the one named by "family"), counted exactly by sorting the outputs,
+ * and also with a Bitmap for 32-bit outputs.  The sort takes 8 bytes a
+ * key, or 1/2^chunkBits of that when the outputs are split by their
+ * top (mixed) bits and counted one part at a time.  Each family is
+ * compared with the collisions an ideal random hash of its width would
+ * have.  HyperLogLog and KMV estimates of the distinct count are shown
+ * with 95% intervals, to show what bounded memory can and cannot tell:
+ * their error is larger than the collisions being measured.
+ *************************************************************************/
+void runWide()
+{
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   string only = option("family", "");
+   uint64_t seed = seedOption("seed", 1);
+   int chunkBits = max(0L, min(intOption("chunkBits", 0), 16L));
+   long hllBits = intOption("hllBits", 14);
+   long kmvSize = intOption("kmv", 1024);
+   if (hllBits < 4 || hllBits > 18 || kmvSize < 3)
+   {
+      cerr << "hllBits must be from 4 to 18 and kmv at least 3" << endl;
+      return;
+   }
+   double n = words.size();
+
+   cout << "Keys: " << words.size() << endl;
+   cout << left << setw(24) << "method" << right << setw(14) << "distinct"
+        << setw(12) << "+/- 95%" << setw(14) << "collisions"
+        << setw(12) << "rate" << setw(12) << "memory kB" << endl;
+
+   for (size_t f = 0; f < numHashFamilies; f++)
+   {
+      const HashFamily &family = hashFamilies[f];
+      if (!only.empty() && only != family.name)
+         continue;
+
+      Bitmap exact;
+      HyperLogLog hll(hllBits);
+      MinValues kmv(kmvSize);
+      for (size_t i = 0; i < words.size(); i++)
+      {
+         uint64_t h = family.hash(words[i].data(), words[i].length(), seed);
+         if (family.bits <= 32)
+            exact.insert(h);
+         hll.add(h);
+         kmv.add(h);
+      }
+
+      // equal outputs mix to equal values, so they land in the same part
+      uint64_t sorted = 0;
+      size_t sortBytes = 0;
+      vector<uint64_t> part;
+      for (uint64_t chunk = 0; chunk < ((uint64_t) 1 << chunkBits); chunk++)
+      {
+         part.clear();
+         for (size_t i = 0; i < words.size(); i++)
+         {
+            uint64_t h = family.hash(words[i].data(), words[i].length(),
+                                     seed);
+            if (chunkBits == 0 || mix64(h) >> (64 - chunkBits) == chunk)
+               part.push_back(h);
+         }
+         sorted += sortedDistinct(part);
+         sortBytes = max(sortBytes, part.capacity() * sizeof(uint64_t));
+      }
+
+      double space = ldexp(1.0, family.bits);
+      double ideal = family.bits <= 32
+                        ? n - space * -expm1(n * log1p(-1 / space))
+                        : n * (n - 1) / 2 / space;
+
+      // error < 0 marks an exact count, whose collisions are shown
+      struct Row { string method; double distinct; double error;
+                   size_t bytes; };
+      vector<Row> rows;
+      string name = family.name;
+      Row counted = { name + " exact (sort)", (double) sorted, -1,
+                      sortBytes };
+      rows.push_back(counted);
+      if (family.bits <= 32)
+      {
+         Row row = { name + " exact (bitmap)", (double) exact.size(), -1,
+                     exact.bytes() };
+         rows.push_back(row);
+      }
+      Row others[] = {
+         { name + " HyperLogLog", hll.estimate(),
+           1.96 * hll.standardError() * hll.estimate(), hll.bytes() },
+         { name + " KMV", kmv.estimate(),
+           1.96 * kmv.standardError() * kmv.estimate(), kmv.bytes() },
+         { name + " ideal", n - ideal, -1, 0 }
+      };
+      rows.insert(rows.end(), others, others + 3);
+
+      for (size_t r = 0; r < rows.size(); r++)
+      {
+         cout << left << setw(24) << rows[r].method << right << fixed
+              << setprecision(0) << setw(14) << rows[r].distinct;
+         if (rows[r].error >= 0)
+            cout << setw(12) << rows[r].error << setw(14) << "-"
+                 << setw(12) << "-";
+         else
+         {
+            double collisions = n - rows[r].distinct;
+            cout << setw(12) << "" << setprecision(2) << setw(14)
+                 << collisions << setprecision(6) << setw(12)
+                 << collisions / n;
+         }
+         cout << setprecision(1) << setw(12) << rows[r].bytes / 1024.0
+              << endl;
+      }
+   }
+   cout.unsetf(ios::fixed);
+   cout << setprecision(6);
+}
+
+/*************************************************************************
+ * runFamilies
+ *
+ * Scores every hash family on the corpus: its energy once reduced to
+ * HASH_SIZE and its cost per word, timed after "warmup" untimed passes
+ * so the first family is not charged for a cold corpus.  The padded
+ * word-at-a-time kernels are timed on a PaddedCorpus and checked
+ * against their plain versions.
+ *************************************************************************/
+void runFamilies()
+{
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   uint64_t seed = seedOption("seed", 1);
+   int warmup = intOption("warmup", 1);
+   int reps = intOption("reps", 5);
+   Histogram histogram;
+
+   cout << "CPU: crc32 " << (cpuHasCrc32() ? "yes" : "no")
+        << ", pclmul " << (cpuHasClmul() ? "yes" : "no") << endl;
+   cout << "Seed: " << seed << endl;
+   cout << left << setw(18) << "family" << right << setw(6) << "bits"
+        << setw(7) << "keyed" << setw(14) << "energy" << setw(12)
+        << "ns/word" << setw(10) << "x poly32" << endl;
+   double polyNs = 0, cheapestNs = 0;
+   const HashFamily *cheapest = NULL;
+   for (size_t f = 0; f < numHashFamilies; f++)
+   {
+      const HashFamily &family = hashFamilies[f];
+      vector<double> samples;
+      for (int rep = -warmup; rep < reps; rep++)
+      {
+         Clock::time_point start = Clock::now();
+         uint64_t sink = 0;
+         for (size_t i = 0; i < words.size(); i++)
+            sink += family.hash(words[i].data(), words[i].length(), seed);
+         if (rep >= 0)
+            samples.push_back(nanosSince(start) / words.size());
+         benchSink += sink;
+      }
+
+      // the cost of each family against the unkeyed hashCode, and the
+      // cheapest one an attacker cannot choose collisions for
+      double ns = percentile(samples, 50);
+      if (string(family.name) == "poly32")
+         polyNs = ns;
+      if (family.keyed && (!cheapest || ns < cheapestNs))
+      {
+         cheapest = &family;
+         cheapestNs = ns;
+      }
+      cout << left << setw(18) << family.name << right
+           << setw(6) << family.bits << setw(7) << (family.keyed ? "yes" : "")
+           << setw(14) << familyEnergy(family, seed, words, histogram)
+           << setw(12) << fixed << setprecision(2) << ns
+           << setw(10) << ns / polyNs << endl;
+      cout.unsetf(ios::fixed);
+      cout << setprecision(6);
+   }
+   PaddedCorpus padded(words);
+   for (size_t f = 0; f < numPaddedHashFamilies; f++)
+   {
+      const HashFamily &family = paddedHashFamilies[f];
+      const HashFamily &plain = *findHashFamily(family.name);
+      size_t mismatches = 0;
+      for (size_t i = 0; i < padded.size(); i++)
+         mismatches += family.hash(padded.data(i), padded.lengths[i], seed) !=
+                       plain.hash(words[i].data(), words[i].length(), seed);
+
+      vector<double> samples;
+      for (int rep = -warmup; rep < reps; rep++)
+      {
+         Clock::time_point start = Clock::now();
+         uint64_t sink = 0;
+         for (size_t i = 0; i < padded.size(); i++)
+            sink += family.hash(padded.data(i), padded.lengths[i], seed);
+         if (rep >= 0)
+            samples.push_back(nanosSince(start) / words.size());
+         benchSink += sink;
+      }
+
+      double ns = percentile(samples, 50);
+      cout << left << setw(18) << (string(family.name) + "[pad]") << right
+           << setw(6) << family.bits << setw(7) << ""
+           << setw(14) << (mismatches ? "MISMATCH" : "same")
+           << setw(12) << fixed << setprecision(2) << ns
+           << setw(10) << ns / polyNs << endl;
+      cout.unsetf(ios::fixed);
+      cout << setprecision(6);
+   }
+   if (cheapest)
+      cout << "Cheapest keyed: " << cheapest->name << " (" << fixed
+           << setprecision(2) << cheapestNs << " ns/word, "
+           << cheapestNs / polyNs << " x poly32)" << endl;
+   cout.unsetf(ios::fixed);
+   cout << setprecision(6);
+}
+
+/*************************************************************************
+ * runMphf
+ *
+ * Builds a minimal perfect hash over the distinct words of the corpus,
+ * checks that it is perfect, and compares its lookup cost with
+ * hashCode.
+ *************************************************************************/
+void runMphf()
 {
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = corpus.distinctWords();
+   if (words.empty())
+      return;
+
+   int threads = threadsOption();
+   if (threads == 0)
+      return;
+   long partitionSize = intOption("partitionSize", 100000);
+   double c = atof(option("c", "5").c_str());
+   uint64_t seed = intOption("seed", 1);
+   if (partitionSize < 1 || !(c > 0))
+   {
+      cerr << "partitionSize must be at least 1 and c above 0" << endl;
+      return;
+   }
+
+   PerfectHash mphf;
+   vector<uint64_t> keys(words.size());
+   Clock::time_point start = Clock::now();
+   for (int attempt = 0; ; attempt++, seed++)
+   {
+      for (size_t i = 0; i < words.size(); i++)
+         keys[i] = foldHash64(words[i].data(), words[i].length(), seed);
+      vector<uint64_t> sorted(keys);
+      sort(sorted.begin(), sorted.end());
+      if (adjacent_find(sorted.begin(), sorted.end()) == sorted.end() &&
+          mphf.build(keys, partitionSize, c, threads))
+         break;
+      if (attempt == 10)
+      {
+         cerr << "Could not build a perfect hash" << endl;
+         return;
+      }
+   }
+   double buildSeconds = nanosSince(start) / 1e9;
+
+   vector<char> seen(words.size(), 0);
+   size_t bad = 0;
+   for (size_t i = 0; i < words.size(); i++)
+   {
+      uint64_t slot = mphf.lookup(keys[i]);
+      if (slot >= words.size() || seen[slot]++)
+         bad++;
+   }
+
+   int reps = intOption("reps", 5);
+   vector<double> lookupSamples, hashSamples;
+   for (int rep = 0; rep < reps; rep++)
+   {
+      Clock::time_point t = Clock::now();
+      uint64_t sink = 0;
+      for (size_t i = 0; i < words.size(); i++)
+         sink += mphf.lookup(foldHash64(words[i].data(), words[i].length(),
+                                        seed));
+      lookupSamples.push_back(nanosSince(t) / words.size());
+
+      t = Clock::now();
+      HashParams params;
+      for (size_t i = 0; i < words.size(); i++)
+         sink += hashWith(params, words[i]);
+      hashSamples.push_back(nanosSince(t) / words.size());
+      benchSink += sink;
+   }
+
+   cout << "Distinct keys: " << words.size() << endl;
+   cout << "Build: " << buildSeconds << " s on " << threads
+        << " threads (seed " << seed << ")" << endl;
+   cout << "Bits per key: " << (double) mphf.bits() / words.size() << endl;
+   cout << "Perfect: " << (bad == 0 ? "yes" : "NO") << endl;
+   cout << "Lookup: " << percentile(lookupSamples, 50) << " ns/word"
+        << " (hashCode " << percentile(hashSamples, 50) << " ns/word)"
+        << endl;
+}
+
+/*************************************************************************
+ * runEmit
+ *
+ * Anneals the hash parameters and writes the best ones found as a
+ * constexpr C++ header.
+ *************************************************************************/
+void runEmit()
+{
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   AnnealResult result = annealWords(words);
+
+   vector<string> samples;
+   size_t count = min<size_t>(intOption("samples", 5), words.size());
+   for (size_t i = 0; i < count; i++)
+      samples.push_back(string(words[i * (words.size() - 1) /
+                                     max<size_t>(count - 1, 1)]));
+
+   string out = option("out", "tuned_hash.h");
+   ofstream fout(out.c_str());
+   if (fout.fail())
+   {
+      cerr << "Error writing " << out << endl;
+      return;
+   }
+   writeHashHeader(fout, result.best, result.bestEnergy, samples,
+                   option("namespace", "tuned_hash"));
+   cout << "Best: " << result.best << endl;
+   cout << "Average number of collisions: " << result.bestEnergy << endl;
+   cout << "Wrote " << out << endl;
+}
+
+/*************************************************************************
+ * TargetHash
+ *
+ * An AttackTarget's table index as a std::hash, so a chained
+ * unordered_map can be filled with attack keys and timed.
+ *************************************************************************/
+struct TargetHash
+{
+   const AttackTarget *target;
+
+   size_t operator()(string_view key) const { return target->index(key); }
+};
+
+/*************************************************************************
+ * degradation
+ *
+ * What a key set does to a table using the target: the slots it
+ * occupies, calcEnergy's average on it, and the ns per key to insert
+ * it into a chained hash table keyed by the target's index.
+ *************************************************************************/
+struct Degradation
+{
+   size_t slots;
+   double energy;
+   double insertNs;
+};
+
+Degradation degradation(const AttackTarget &target, const vector<string> &keys)
+{
+   vector<string_view> views(keys.begin(), keys.end());
+   Degradation result;
+
+   set<unsigned int> slots;
+   for (size_t i = 0; i < views.size(); i++)
+      slots.insert(target.index(views[i]));
+   result.slots = slots.size();
+
+   Histogram histogram;
+   result.energy = target.family
+                 ? familyEnergy(*target.family, target.seed, views, histogram)
+                 : energyOf(target.params, views, histogram);
+
+   unordered_map<string_view, int, TargetHash> table(16, TargetHash{&target});
+   Clock::time_point start = Clock::now();
+   for (size_t i = 0; i < views.size(); i++)
+      table[views[i]] = (int) i;
+   result.insertNs = nanosSince(start) / (double) max<size_t>(views.size(), 1);
+   return result;
+}
+
+/*************************************************************************
+ * runAttack
+ *
+ * How fast an attacker can fill one slot of a table using a hash (the
+ * family named by "family", or hashWith with "multiplier").  The block
+ * attack finds pairs of equal-hash blocks and concatenates them into
+ * "keys" colliding keys, which only works on hashes that compose; the
+ * brute-force attack, which works on any hash, tries random keys until
+ * "bruteKeys" share a slot.  The larger colliding set is then compared
+ * with as many random keys of the same lengths, in a table whose keyed
+ * family uses "victimSeed" (by default the seed the keys were found
+ * with; seed=random or victimSeed=random for processSeed).
+ *************************************************************************/
+void runAttack()
+{
+   int threads = threadsOption();
+   if (threads == 0)
+      return;
+   uint64_t seed = seedOption("seed", 1);
+   size_t count = intOption("keys", 4096);
+
+   string familyName = option("family", "");
+   HashParams params;
+   params.multiplier = intOption("multiplier", params.multiplier);
+   const HashFamily *family = familyName.empty() ? NULL
+                            : findHashFamily(familyName);
+   if (!familyName.empty() && !family)
+   {
+      cerr << "Unknown hash family: " << familyName << endl;
+      return;
+   }
+   AttackTarget target = family ? AttackTarget(*family, seed)
+                                : AttackTarget(params);
+   cout << "Target: " << target.name() << endl;
+   if (!family)
+      cout << "Short swaps: " << adversarialPartners(params, 2)
+           << " partners per 2-character string, "
+           << adversarialPartners(params, 3) << " per 3-character string"
+           << endl;
+
+   // block attack: log2(keys) pairs give `count` keys
+   size_t pairsNeeded = 1;
+   while (((size_t) 1 << pairsNeeded) < count)
+      pairsNeeded++;
+   size_t length = intOption("blockLength", 6);
+   uint64_t tried = 0;
+   Clock::time_point start = Clock::now();
+   vector<BlockPair> pairs = findCollidingBlocks(target, pairsNeeded, length,
+                                                 threads, seed,
+                                                 intOption("budget", 1 << 22),
+                                                 &tried);
+   vector<string> blockSet = blockKeys(pairs, count);
+   double blockSeconds = nanosSince(start) / 1e9;
+   cout << "Block attack: " << pairs.size() << " equal-hash pairs of "
+        << length << "-character blocks from " << tried << " blocks in "
+        << blockSeconds << " s";
+   if (!pairs.empty())
+      cout << " (e.g. \"" << pairs[0].first << "\" and \""
+           << pairs[0].second << "\")";
+   cout << endl;
+
+   set<unsigned int> blockSlots;
+   for (size_t i = 0; i < blockSet.size(); i++)
+      blockSlots.insert(target.index(blockSet[i]));
+   if (!blockSet.empty())
+      cout << "              " << blockSet.size() << " keys of "
+           << blockSet[0].length() << " characters in " << blockSlots.size()
+           << (blockSlots.size() == 1 ? " slot" : " slots")
+           << (blockSlots.size() == 1 ? "" : ": the hash does not compose")
+           << endl;
+
+   // brute force: any hash, about HASH_SIZE tries per colliding key
+   start = Clock::now();
+   vector<string> bruteSet = bruteForceKeys(target, intOption("bruteKeys", 32),
+                                            threads, seed,
+                                            intOption("bruteBudget", 1 << 24),
+                                            &tried);
+   double bruteSeconds = nanosSince(start) / 1e9;
+   cout << "Brute force: " << bruteSet.size() << " keys in one slot from "
+        << tried << " keys in " << bruteSeconds << " s ("
+        << tried / max<size_t>(bruteSet.size() - 1, 1) << " keys per hit, "
+        << (bruteSet.size() - 1) / bruteSeconds << " hits/s)" << endl;
+
+   // the larger set that really shares a slot, against random keys
+   bool blocksWork = blockSlots.size() == 1 && blockSet.size() > 1;
+   const vector<string> &attack = blocksWork ? blockSet : bruteSet;
+   mt19937_64 random(seed);
+   vector<string> normal;
+   for (size_t i = 0; i < attack.size(); i++)
+   {
+      string key(attack[i].length(), ' ');
+      for (size_t j = 0; j < key.length(); j++)
+         key[j] = (char) (32 + random() % 95);
+      normal.push_back(key);
+   }
+
+   // a keyed family in production has a seed the attacker never saw
+   AttackTarget victim = family ? AttackTarget(*family,
+                                               seedOption("victimSeed", seed))
+                                : target;
+   Degradation before = degradation(victim, normal);
+   Degradation after = degradation(victim, attack);
+   cout << "Degradation on " << attack.size() << " keys ("
+        << (blocksWork ? "block" : "brute force") << " attack";
+   if (victim.seed != target.seed)
+      cout << ", table seeded with " << victim.seed;
+   cout << "):" << endl;
+   cout << setw(36) << "random" << setw(12) << "attack" << endl;
+   cout << left << setw(24) << "   slots used" << right << setw(12)
+        << before.slots << setw(12) << after.slots << endl;
+   cout << left << setw(24) << "   collisions" << right << setw(12)
+        << before.energy << setw(12) << after.energy << endl;
+   cout << left << setw(24) << "   insert ns/key" << right << fixed
+        << setprecision(1) << setw(12) << before.insertNs << setw(12)
+        << after.insertNs << endl;
+   cout.unsetf(ios::fixed);
+   cout << setprecision(6);
+}
+
+/*************************************************************************
+ * peakRssKb
+ *
+ * The peak resident set size of this process so far, in kilobytes.
+ *************************************************************************/
+long peakRssKb()
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss;
+}
+
+/*************************************************************************
+ * runAnnealBench
+ *
+ * End-to-end throughput: 1, 2, 4 ... `threads` independent, seeded
+ * annealing chains of `steps` iterations each (weak scaling), so every
+ * row does the same work per core.  The chains are built, words laid
+ * out, before the clock starts, so only the search is timed.  Prints a
+ * scaling table, with steps/s in all and per chain, and appends it to
+ * the "out" CSV file.
+ *************************************************************************/
+void runAnnealBench()
+{
+   long steps = intOption("steps", 64);
+   unsigned int seed = intOption("seed", 1);
+   int maxThreads = threadsOption();
+   if (maxThreads == 0)
+      return;
+   Corpus corpus = loadCorpus();
+   const vector<string_view> &words = scoredWords(corpus);
+   if (words.empty())
+      return;
+
+   vector<int> counts;
+   for (int n = 1; n < maxThreads; n *= 2)
+      counts.push_back(n);
+   counts.push_back(maxThreads);
+
+   string out = option("out", "scaling.csv");
+   ifstream existing(out.c_str());
+   bool header = !existing.good();
+   existing.close();
+   ofstream fout(out.c_str(), ios::app);
+   if (header)
+      fout << "threads,steps,seconds,steps_per_s,evals_per_s,"
+           << "words_per_s,best_energy,peak_rss_kb" << endl;
+
+   cout << setw(8) << "threads" << setw(12) << "steps/s"
+        << setw(12) << "per chain" << setw(12) << "evals/s"
+        << setw(14) << "words/s" << setw(12) << "speedup"
+        << setw(14) << "peak RSS kB" << endl;
+
+   double baseline = 0;
+   for (size_t c = 0; c < counts.size(); c++)
+   {
+      int threads = counts[c];
+      vector<AnnealResult> results(threads);
+      vector<AnnealProgress> progress(threads);
+      vector<unique_ptr<Annealer> > chains;
+      for (int t = 0; t < threads; t++)
+      {
+         chains.push_back(unique_ptr<Annealer>(new Annealer(words,
+                                                             seed + t)));
+         chains[t]->setProgress(&progress[t]);
+      }
+      vector<thread> workers;
+
+      Clock::time_point start = Clock::now();
+      ProgressReporter reporter(progress,
+                                atof(option("progress", "0").c_str()),
+                                option("progressFile", ""));
+      for (int t = 0; t < threads; t++)
+         workers.push_back(thread([&results, &chains, t, steps]()
+         {
+            results[t] = chains[t]->run(steps);
+         }));
+      for (int t = 0; t < threads; t++)
+         workers[t].join();
+      double seconds = nanosSince(start) / 1e9;
+      reporter.stop();
+
+      long evaluations = 0;
+      long hashed = 0;
+      double best = results[0].bestEnergy;
+      for (int t = 0; t < threads; t++)
+      {
+         evaluations += results[t].evaluations;
+         hashed += results[t].wordsHashed;
+         best = min(best, results[t].bestEnergy);
+      }
+
+      double stepsPerSecond = steps * threads / seconds;
+      if (c == 0)
+         baseline = stepsPerSecond;
+
+      cout << setw(8) << threads << fixed << setprecision(1)
+           << setw(12) << stepsPerSecond
+           << setw(12) << stepsPerSecond / threads
+           << setw(12) << evaluations / seconds
+           << setw(14) << setprecision(0) << hashed / seconds
+           << setw(11) << setprecision(2) << stepsPerSecond / baseline << 'x'
+           << setw(14) << peakRssKb() << endl;
+      cout.unsetf(ios::fixed);
+
+      fout << threads << ',' << steps << ',' << seconds << ','
+           << stepsPerSecond << ',' << evaluations / seconds << ','
+           << hashed / seconds << ',' << best << ',' << peakRssKb() << endl;
+   }
+}
+
+/*************************************************************************
+ * Checker
+ *
+ * Counts and reports the outcomes of the checks run by "check".  Only
+ * failures are printed in full; each section ends with one line.
+ *************************************************************************/
+class Checker
+{
+public:
+   Checker() : passed(0), failed(0), sectionPassed(0), sectionFailed(0) {}
+
+   void section(const string &name)
+   {
+      endSection();
+      current = name;
+      sectionPassed = sectionFailed = 0;
+   }
+
+   bool expect(bool ok, const string &what)
+   {
+      if (ok)
+      {
+         passed++;
+         sectionPassed++;
+      }
+      else
+      {
+         failed++;
+         sectionFailed++;
+         cout << "FAIL " << current << ": " << what << endl;
+      }
+      return ok;
+   }
+
+   template <class T>
+   bool expectEqual(const T &actual, const T &expected, const string &what)
+   {
+      if (actual == expected)
+         return expect(true, what);
+      ostringstream detail;
+      detail << setprecision(17) << what << ": got " << actual
+             << ", expected " << expected;
+      return expect(false, detail.str());
+   }
+
+   void endSection()
+   {
+      if (current.empty())
+         return;
+      cout << (sectionFailed ? "FAIL " : "ok   ") << left << setw(28)
+           << current << right << sectionPassed << " passed";
+      if (sectionFailed)
+         cout << ", " << sectionFailed << " failed";
+      cout << endl;
+      current.clear();
+   }
+
+   int passed;
+   int failed;
+
+private:
+   string current;
+   int sectionPassed;
+   int sectionFailed;
+};
+
+/*************************************************************************
+ * randomBytes / randomWords
+ *
+ * Inputs for the differential checks.  randomBytes can hold any byte,
+ * including NUL, whitespace and bytes above 127 (negative as a char,
+ * which is where hashCode's signed arithmetic matters), at lengths from
+ * empty to past LengthBuckets::MAX_LENGTH.  randomWords are non-empty
+ * and free of whitespace so they also survive the text corpus format.
+ *************************************************************************/
+vector<string> randomBytes(mt19937 &random, size_t count)
+{
+   vector<string> words(count);
+   for (size_t i = 0; i < count; i++)
+   {
+      unsigned int kind = random() % 20;
+      size_t length = kind < 16 ? random() % 17
+                    : kind < 19 ? 17 + random() % 48
+                    : 65 + random() % 200;
+      for (size_t j = 0; j < length; j++)
+         words[i] += (char) (random() & 0xff);
+   }
+   return words;
+}
+
+vector<string> randomWords(mt19937 &random, size_t count)
+{
+   vector<string> words = randomBytes(random, count);
+   for (size_t i = 0; i < words.size(); i++)
+   {
+      for (size_t j = 0; j < words[i].length(); j++)
+         if (words[i][j] == 0 || isspace((unsigned char) words[i][j]))
+            words[i][j] = 'a' + j % 26;
+      if (words[i].empty())
+         words[i] = "x";
+   }
+   return words;
+}
+
+vector<string_view> viewsOf(const vector<string> &words)
+{
+   return vector<string_view>(words.begin(), words.end());
+}
+
+// random constants for hashWith and safteyHashWith
+HashParams randomParams(mt19937 &random)
+{
+   HashParams params;
+   params.multiplier = random();
+   for (int s = 0; s < 4; s++)
+      params.shifts[s] = 1 + random() % 31;
+   return params;
+}
+
+/*************************************************************************
+ * checkGolden
+ *
+ * Today's outputs of the reference functions, pinned: hashCode of words
+ * from the words file (and a checksum over all of it), safteyHash at
+ * edge values, and calcEnergy of the checked-in hashed file.
+ *************************************************************************/
+void checkGolden(Checker &check, const string &wordsFile,
+                 const string &hashedFile)
+{
+   check.section("golden hashCode");
+   struct { const char *word; unsigned int hash; } codes[] =
+   {
+      { "", 0 },
+      { "1080", 459095 },
+      { "ZZZ", 89370 },
+      { "debitum", 989316 },
+      { "abovedeck", 985542 },
+      { "Montgomeryville", 787683 },
+      { "dichlorodiphenyltrichloroethane", 331180 },
+      { "pneumonoultramicroscopicsilicovolcanoconiosis", 469908 },
+   };
+   for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++)
+   {
+      string word = codes[i].word;
+      check.expectEqual(hashCode(word), codes[i].hash,
+                        "hashCode(\"" + word + "\")");
+   }
+   // chars are signed where hashCode was written (x86): bytes above
+   // 127 count as negative
+   check.expectEqual(polyHash32("\xe9t\xe9", 3, 0), (uint64_t) 4294948766u,
+                     "polyHash32 of bytes e9 74 e9");
+
+   Corpus corpus;
+   if (check.expect(corpus.load(wordsFile), "read " + wordsFile))
+   {
+      uint64_t checksum = 0;
+      for (size_t i = 0; i < corpus.size(); i++)
+      {
+         string word(corpus.words()[i]);
+         checksum = checksum * 1000003 + hashCode(word);
+      }
+      check.expectEqual(corpus.size(), (size_t) 479829, "words in file");
+      check.expectEqual(checksum, (uint64_t) 18223797721645366598ULL,
+                        "checksum of hashCode over the words file");
+   }
+
+   check.section("golden safteyHash");
+   struct { unsigned int h; int rehashed; } edges[] =
+   {
+      { 0, 0 },
+      { 1, 1 },
+      { 2, 2 },
+      { HASH_SIZE - 1, 990990 },
+      { HASH_SIZE, 1122579 },
+      { 0x12345678u, 322062775 },
+      { 0x7fffffffu, 2029549455 },
+      { 0x80000000u, -1995925360 },
+      { 0xdeadbeefu, -755557136 },
+      { 0xffffffffu, -235868385 },
+   };
+   for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+   {
+      check.expectEqual(safteyHash(edges[i].h), edges[i].rehashed,
+                        "safteyHash(" + to_string(edges[i].h) + ")");
+      check.expectEqual(safteyHashWith(HashParams(), edges[i].h),
+                        edges[i].rehashed,
+                        "safteyHashWith(" + to_string(edges[i].h) + ")");
+   }
+
+   check.section("golden calcEnergy");
+   check.expectEqual(calcEnergy(hashedFile), 0.086303621396940963,
+                     "calcEnergy(\"" + hashedFile + "\")");
+   check.expectEqual(calcEnergy("no such file"), -1.0,
+                     "calcEnergy of a missing file");
+   uint32_t crc = crc32cSoft("123456789", 9, 0);
+   check.expectEqual(crc, 0xe3069283u, "crc32c check value");
+}
+
+/*************************************************************************
+ * checkEnergyPaths
+ *
+ * Every way of computing an energy against energyOf, and energyOf
+ * against calcEnergy itself (through a hashed file written here), for
+ * the default constants and `rounds` random ones, on `words`.
+ *************************************************************************/
+void checkEnergyPaths(Checker &check, const vector<string_view> &words,
+                      int rounds, mt19937 &random, const string &label)
+{
+   check.section("energy paths (" + label + ")");
+   if (!check.expect(!words.empty(), "no words"))
+      return;
+
+   {
+      ofstream hashed("check-hashed.tmp");
+      for (size_t i = 0; i < words.size(); i++)
+         hashed << hashWith(HashParams(), words[i]) << endl;
+   }
+   Histogram histogram;
+   double reference = energyOf(HashParams(), words, histogram);
+   check.expectEqual(reference, calcEnergy("check-hashed.tmp"),
+                     "energyOf vs calcEnergy");
+   remove("check-hashed.tmp");
+
+   LengthBuckets buckets(words);
+   EnergyScratch scratch;
+   EnergyFunction energy(words);
+   for (int round = 0; round <= rounds; round++)
+   {
+      HashParams params = round == 0 ? HashParams() : randomParams(random);
+      ostringstream name;
+      name << params;
+
+      vector<unsigned int> hashes;
+      vector<uint32_t> lanes;
+      buckets.hashAll(params, hashes, lanes);
+      size_t wrong = 0;
+      for (size_t i = 0; i < words.size(); i++)
+         wrong += hashes[i] != hashWith(params, words[i]);
+      check.expectEqual(wrong, (size_t) 0,
+                        "LengthBuckets::hashAll mismatches, " + name.str());
+
+      double expected = energyOf(params, words, histogram);
+      check.expectEqual(bucketEnergyOf(params, buckets, scratch), expected,
+                        "bucketEnergyOf, " + name.str());
+      check.expectEqual(energy(params), expected,
+                        "EnergyFunction, " + name.str());
+   }
+}
+
+/*************************************************************************
+ * checkCorpusPaths
+ *
+ * Corpus loading, dedupEnergy and streamEnergy against a plain
+ * reading of the same words: a text file and a binary corpus file are
+ * written from `words` and read back every way there is.
+ *************************************************************************/
+void checkCorpusPaths(Checker &check, const vector<string> &words,
+                      int rounds, mt19937 &random)
+{
+   check.section("corpus and stream paths");
+   vector<string_view> views = viewsOf(words);
+   {
+      ofstream text("check-words.tmp");
+      for (size_t i = 0; i < words.size(); i++)
+         text << words[i] << (i % 7 == 0 ? "\n" : " \t ");
+      ofstream binary("check-words.bin.tmp", ios::binary);
+      writeCorpusHeader(binary, words.size());
+      for (size_t i = 0; i < words.size(); i++)
+         writeCorpusWord(binary, words[i]);
+   }
+
+   const char *files[] = { "check-words.tmp", "check-words.bin.tmp" };
+   for (int f = 0; f < 2; f++)
+   {
+      Corpus corpus;
+      corpus.load(files[f]);
+      check.expect(corpus.words() == views,
+                   string("Corpus::load of ") + files[f]);
+
+      // ids in order of first appearance; distinctWords in that order
+      set<string_view> seen;
+      vector<string_view> distinct;
+      for (size_t i = 0; i < views.size(); i++)
+         if (seen.insert(views[i]).second)
+            distinct.push_back(views[i]);
+      check.expect(corpus.distinctWords() == distinct,
+                   string("Corpus::distinctWords of ") + files[f]);
+
+      Histogram all, unique, histogram;
+      DedupEnergy dedup = dedupEnergy(HashParams(), corpus, all, unique);
+      check.expectEqual(dedup.energy,
+                        energyOf(HashParams(), views, histogram),
+                        string("dedupEnergy of ") + files[f]);
+      check.expectEqual(dedup.distinctEnergy,
+                        energyOf(HashParams(), distinct, histogram),
+                        string("dedupEnergy distinct of ") + files[f]);
+
+      for (int round = 0; round <= rounds; round++)
+      {
+         HashParams params = round == 0 ? HashParams() : randomParams(random);
+         size_t chunk = 1 + random() % (round % 2 ? 64 : 1 << 16);
+         ostringstream name;
+         name << "streamEnergy of " << files[f] << ", chunk " << chunk
+              << ", " << params;
+         StreamResult streamed = streamEnergy(params, files[f], chunk,
+                                              histogram);
+         check.expectEqual(streamed.words, (unsigned long long) words.size(),
+                           name.str() + " words");
+         check.expectEqual(streamed.energy,
+                           energyOf(params, views, histogram), name.str());
+      }
+   }
+   remove(files[0]);
+   remove(files[1]);
+
+   // the binary format also holds words the text format cannot
+   vector<string> bytes = randomBytes(random, 1000);
+   {
+      ofstream binary("check-bytes.bin.tmp", ios::binary);
+      writeCorpusHeader(binary, bytes.size());
+      for (size_t i = 0; i < bytes.size(); i++)
+         writeCorpusWord(binary, bytes[i]);
+   }
+   Corpus corpus;
+   corpus.load("check-bytes.bin.tmp");
+   check.expect(corpus.words() == viewsOf(bytes),
+                "binary corpus of arbitrary bytes");
+   remove("check-bytes.bin.tmp");
+}
+
+/*************************************************************************
+ * checkFamilies
+ *
+ * Each specialized hash kernel against the scalar one it must equal:
+ * hardware CRC and carry-less multiply against their soft versions,
+ * word-at-a-time and padded kernels against byte-at-a-time ones, and
+ * poly32 against hashWith.
+ *************************************************************************/
+void checkFamilies(Checker &check, const vector<string> &bytes,
+                   const vector<string_view> &words, mt19937 &random)
+{
+   check.section("hash families");
+   struct { const char *fast; const char *reference; } pairs[] =
+   {
+      { "crc32c", "crc32c-soft" },
+      { "clmul64", "clmul64-soft" },
+      { "poly32-wide", "poly32" },
+   };
+   vector<string_view> views = viewsOf(bytes);
+   uint64_t seed = random();
+   for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++)
+   {
+      const HashFamily *fast = findHashFamily(pairs[p].fast);
+      const HashFamily *reference = findHashFamily(pairs[p].reference);
+      if (!check.expect(fast && reference,
+                        string("families ") + pairs[p].fast + " and " +
+                        pairs[p].reference + " registered"))
+         continue;
+      size_t wrong = 0;
+      for (size_t i = 0; i < views.size(); i++)
+         wrong += fast->hash(views[i].data(), views[i].length(), seed) !=
+                  reference->hash(views[i].data(), views[i].length(), seed);
+      check.expectEqual(wrong, (size_t) 0, string(pairs[p].fast) +
+                        " vs " + pairs[p].reference + " mismatches");
+   }
+
+   PaddedCorpus padded(views);
+   for (size_t f = 0; f < numPaddedHashFamilies; f++)
+   {
+      const HashFamily &family = paddedHashFamilies[f];
+      const HashFamily &plain = *findHashFamily(family.name);
+      size_t wrong = 0;
+      for (size_t i = 0; i < padded.size(); i++)
+         wrong += family.hash(padded.data(i), padded.lengths[i], seed) !=
+                  plain.hash(views[i].data(), views[i].length(), seed);
+      check.expectEqual(wrong, (size_t) 0,
+                        string(family.name) + "[pad] mismatches");
+   }
+
+   size_t wrong = 0, low = 0;
+   for (size_t i = 0; i < views.size(); i++)
+   {
+      uint64_t h = polyHash32(views[i].data(), views[i].length(), 0);
+      wrong += h != fullHashWith(HashParams(), views[i]);
+      low += (uint32_t) polyHash64(views[i].data(), views[i].length(), 0) !=
+             h;
+   }
+   check.expectEqual(wrong, (size_t) 0, "poly32 vs fullHashWith mismatches");
+   check.expectEqual(low, (size_t) 0, "poly64 low half vs poly32 mismatches");
+
+   // the SipHash-2-4 reference vectors: key 00..0f, message 00..0e
+   string message;
+   for (char c = 0; c < 15; c++)
+      message += c;
+   uint64_t k0 = 0x0706050403020100ULL, k1 = 0x0f0e0d0c0b0a0908ULL;
+   check.expectEqual(sipHash(message.data(), 0, k0, k1, 2, 4),
+                     (uint64_t) 0x726fdb47dd0e0e31ULL, "SipHash-2-4, empty");
+   check.expectEqual(sipHash(message.data(), 15, k0, k1, 2, 4),
+                     (uint64_t) 0xa129ca6149be45e5ULL, "SipHash-2-4, 15 bytes");
+
+   // keyed families must change with the seed, the others must not
+   uint64_t other = seed ^ 0x5555555555555555ULL;
+   for (size_t f = 0; f < numHashFamilies; f++)
+   {
+      const HashFamily &family = hashFamilies[f];
+      size_t same = 0;
+      for (size_t i = 0; i < views.size(); i++)
+         same += family.hash(views[i].data(), views[i].length(), seed) ==
+                 family.hash(views[i].data(), views[i].length(), other);
+      if (family.keyed)
+         check.expect(same < views.size() / 100,
+                      string(family.name) + " depends on its seed");
+      else
+         check.expectEqual(same, views.size(),
+                           string(family.name) + " ignores the seed");
+   }
+   check.expectEqual(processSeed(), processSeed(), "processSeed is fixed");
+
+   Histogram histogram;
+   check.expectEqual(familyEnergy(*findHashFamily("poly32"), 0, words,
+                                  histogram),
+                     energyOf(HashParams(), words, histogram),
+                     "familyEnergy(poly32) vs energyOf");
+}
+
+/*************************************************************************
+ * checkThreads
+ *
+ * Results that must not depend on threading: annealing chains run in
+ * parallel give what they give alone, an Annealer reused in process
+ * continues exactly like a longer run would, and a PerfectHash built on
+ * many threads is the one built on one.
+ *************************************************************************/
+void checkThreads(Checker &check, const vector<string_view> &words,
+                  mt19937 &random)
+{
+   check.section("threads");
+   const int CHAINS = 4;
+   const long STEPS = 6;
+   vector<AnnealResult> alone(CHAINS), together(CHAINS);
+   for (int t = 0; t < CHAINS; t++)
+      alone[t] = anneal(words, STEPS, 100 + t);
+   vector<thread> workers;
+   for (int t = 0; t < CHAINS; t++)
+      workers.push_back(thread([&together, &words, t]()
+      {
+         together[t] = anneal(words, STEPS, 100 + t);
+      }));
+   for (int t = 0; t < CHAINS; t++)
+      workers[t].join();
+   for (int t = 0; t < CHAINS; t++)
+   {
+      ostringstream a, b;
+      a << alone[t].best;
+      b << together[t].best;
+      check.expectEqual(b.str(), a.str(),
+                        "parallel chain " + to_string(t) + " best");
+      check.expectEqual(together[t].bestEnergy, alone[t].bestEnergy,
+                        "parallel chain " + to_string(t) + " energy");
+   }
+
+   Annealer annealer(words, 7);
+   AnnealResult first = annealer.run(STEPS);
+   AnnealResult second = annealer.run(STEPS, first.best);
+   Annealer again(words, 7);
+   AnnealResult replay = again.run(STEPS);
+   check.expectEqual(replay.bestEnergy, first.bestEnergy,
+                     "Annealer replay with the same seed");
+   check.expect(second.bestEnergy <= first.bestEnergy,
+                "Annealer::run from a best state keeps it");
+   check.expectEqual(annealer.evaluate(first.best), first.bestEnergy,
+                     "Annealer::evaluate of its best state");
+
+   vector<uint64_t> keys;
+   set<uint64_t> unique;
+   uint64_t seed = random();
+   for (size_t i = 0; i < words.size(); i++)
+   {
+      uint64_t key = foldHash64(words[i].data(), words[i].length(), seed);
+      if (unique.insert(key).second)
+         keys.push_back(key);
+   }
+   PerfectHash one, many, none;
+   check.expect(one.build(keys, 5000, 5, 1), "PerfectHash built, 1 thread");
+   check.expect(many.build(keys, 5000, 5, 8), "PerfectHash built, 8 threads");
+   check.expect(none.build(keys, 5000, 5, 0), "PerfectHash built, 0 threads");
+   vector<char> seen(keys.size(), 0);
+   size_t differ = 0, bad = 0;
+   for (size_t i = 0; i < keys.size(); i++)
+   {
+      uint64_t slot = many.lookup(keys[i]);
+      differ += slot != one.lookup(keys[i]) || slot != none.lookup(keys[i]);
+      if (slot >= keys.size() || seen[slot]++)
+         bad++;
+   }
+   check.expectEqual(differ, (size_t) 0, "PerfectHash 1 vs 8 vs 0 threads");
+   check.expectEqual(bad, (size_t) 0, "PerfectHash collisions");
+}
+
+/*************************************************************************
+ * checkBatch
+ *
+ * BatchEnergy against EnergyFunction, with candidates sharing
+ * multipliers so the hash-once path is taken, and the genetic search
+ * giving the same result on one thread and on several.
+ *************************************************************************/
+void checkBatch(Checker &check, const vector<string_view> &words,
+                mt19937 &random)
+{
+   check.section("batch and evolve");
+   vector<HashParams> candidates;
+   for (int i = 0; i < 24; i++)
+   {
+      candidates.push_back(i % 3 && i > 0 ? candidates[i - 1]
+                                          : randomParams(random));
+      candidates.back().shifts[i % 4] = 1 + random() % 31;
+   }
+   EnergyFunction energy(words);
+   for (int threads = 1; threads <= 4; threads += 3)
+   {
+      BatchEnergy batch(words, threads);
+      vector<double> energies;
+      batch(candidates, energies);
+      size_t wrong = 0;
+      for (size_t i = 0; i < candidates.size(); i++)
+         wrong += energies[i] != energy(candidates[i]);
+      check.expectEqual(wrong, (size_t) 0, "BatchEnergy vs EnergyFunction, "
+                        + to_string(threads) + " threads");
+   }
+
+   Evolver one(words, 11, 1), many(words, 11, 4);
+   EvolveResult a = one.run(3, 16), b = many.run(3, 16);
+   ostringstream first, second;
+   first << a.best;
+   second << b.best;
+   check.expectEqual(second.str(), first.str(), "evolve best, 1 vs 4 threads");
+   check.expectEqual(b.bestEnergy, a.bestEnergy,
+                     "evolve energy, 1 vs 4 threads");
+   check.expectEqual(a.bestEnergy, energy(a.best), "evolve energy is exact");
+   check.expect(a.bestEnergy <= energy(HashParams()),
+                "evolve no worse than its start");
+}
+
+/*************************************************************************
+ * checkSweep
+ *
+ * A sweep's top points against scoring every point with
+ * EnergyFunction, and a sweep stopped, checkpointed and resumed ending
+ * exactly like one run straight through.
+ *************************************************************************/
+void checkSweep(Checker &check, const vector<string_view> &words,
+                mt19937 &random)
+{
+   check.section("sweep");
+   HashParams base = randomParams(random);
+   SweepSpace space = SweepSpace::shifts(vector<int>({ 0, 3 }), base);
+   EnergyFunction energy(words);
+   vector<SweepEntry> all;
+   for (uint64_t i = 0; i < space.size(); i++)
+   {
+      SweepEntry entry = { i, energy(space.at(i)) };
+      all.push_back(entry);
+   }
+   stable_sort(all.begin(), all.end(), [](const SweepEntry &a,
+                                          const SweepEntry &b)
+   {
+      return a.energy < b.energy;
+   });
+
+   BatchEnergy batch(words, 3);
+   Sweep straight(space, 5, energy(base));
+   straight.run(batch, space.size(), 100, "");
+   vector<SweepEntry> top = straight.top();
+   check.expectEqual(top.size(), (size_t) 5, "sweep keeps top 5");
+   size_t wrong = 0;
+   for (size_t i = 0; i < top.size(); i++)
+      wrong += top[i].index != all[i].index || top[i].energy != all[i].energy;
+   check.expectEqual(wrong, (size_t) 0, "sweep top 5 vs every point scored");
+
+   Sweep stopped(space, 5, energy(base));
+   stopped.run(batch, 300, 64, "check-sweep.tmp");
+   Sweep resumed(space, 5, energy(base));
+   check.expect(resumed.load("check-sweep.tmp"), "sweep checkpoint loads");
+   check.expectEqual(resumed.next, (uint64_t) 300, "sweep resumes at 300");
+   resumed.run(batch, space.size(), 64, "check-sweep.tmp");
+   vector<SweepEntry> after = resumed.top();
+   wrong = after.size() != top.size();
+   for (size_t i = 0; i < after.size() && i < top.size(); i++)
+      wrong += after[i].index != top[i].index ||
+               after[i].energy != top[i].energy;
+   check.expectEqual(wrong, (size_t) 0, "resumed sweep vs straight through");
+   check.expectEqual(resumed.better, straight.better,
+                     "resumed sweep points better than base");
+   remove("check-sweep.tmp");
+
+   Sweep other(SweepSpace::shifts(vector<int>(1, 1), base), 5, energy(base));
+   check.expect(!other.load("check-sweep.tmp"), "no checkpoint, no resume");
+   check.expect(!other.run(batch, 10, 10, "no-such-directory/check-sweep"),
+                "sweep reports a checkpoint it cannot write");
+   check.expectEqual(other.next, (uint64_t) 10,
+                     "sweep stops after the batch it could not save");
+}
+
+/*************************************************************************
+ * checkAttack
+ *
+ * adversarialPartners against hashing every printable string of 2 and
+ * 3 characters, and every key the block attack builds having the same
+ * full hash, both for the classic "Aa"/"BB" pair and for pairs it finds.
+ *************************************************************************/
+void checkAttack(Checker &check, mt19937 &random)
+{
+   check.section("attack");
+   vector<HashParams> multipliers(4);
+   multipliers[1].multiplier = 1 + random() % 200;
+   multipliers[2].multiplier = 0x10000 + random() % 64;
+   multipliers[3].multiplier = random() | 1;
+   for (size_t p = 0; p < multipliers.size(); p++)
+      for (int length = 2; length <= 3; length++)
+      {
+         vector<unsigned int> hashes;
+         string text(length, ' ');
+         for (size_t s = 0; s < (length == 2 ? 95u * 95 : 95u * 95 * 95); s++)
+         {
+            for (int i = 0, rest = (int) s; i < length; i++, rest /= 95)
+               text[i] = (char) (32 + rest % 95);
+            hashes.push_back(fullHashWith(multipliers[p], text));
+         }
+         sort(hashes.begin(), hashes.end());
+         double pairs = 0;
+         for (size_t i = 0, j; i < hashes.size(); i = j)
+         {
+            for (j = i; j < hashes.size() && hashes[j] == hashes[i]; j++)
+               ;
+            pairs += (double) (j - i) * (j - i - 1);
+         }
+         check.expectEqual(adversarialPartners(multipliers[p], length),
+                           pairs / hashes.size(),
+                           "adversarialPartners, multiplier "
+                           + to_string(multipliers[p].multiplier)
+                           + ", length " + to_string(length));
+      }
+
+   vector<BlockPair> classic(10);
+   for (size_t i = 0; i < classic.size(); i++)
+   {
+      classic[i].first = "Aa";
+      classic[i].second = "BB";
+   }
+   AttackTarget target((HashParams()));
+   vector<string> keys = blockKeys(classic, 1024);
+   set<string> distinct(keys.begin(), keys.end());
+   check.expectEqual(distinct.size(), (size_t) 1024, "Aa/BB keys distinct");
+   size_t same = 0;
+   for (size_t i = 0; i < keys.size(); i++)
+      same += hashCode(keys[i]) == hashCode(keys[0]);
+   check.expectEqual(same, keys.size(), "Aa/BB keys share hashCode");
+
+   vector<BlockPair> found = findCollidingBlocks(target, 8, 6, 4, random(),
+                                                 1 << 18, NULL);
+   check.expect(!found.empty(), "findCollidingBlocks finds pairs");
+   keys = blockKeys(found, 256);
+   same = 0;
+   for (size_t i = 0; i < keys.size(); i++)
+      same += target.full(keys[i]) == target.full(keys[0]);
+   check.expectEqual(same, keys.size(), "found block keys share full hash");
+}
+
+/*************************************************************************
+ * runCheck
+ *
+ * The correctness suite: golden values first, then randomized
+ * differential checks of every optimized path against the scalar
+ * reference, on the corpus and on random words.  Prints one line per
+ * section and every failure, and ends with "Check: N passed, M failed".
+ *************************************************************************/
+void runCheck()
+{
+   Checker check;
+   mt19937 random(intOption("seed", 1));
+   int rounds = intOption("rounds", 8);
+
+   checkGolden(check, option("words", "words"), option("hashed", "hashed"));
+
+   Corpus corpus = loadCorpus();
+   checkEnergyPaths(check, scoredWords(corpus), rounds, random, "corpus");
+
+   vector<string> words = randomWords(random, intOption("count", 20000));
+   vector<string> bytes = randomBytes(random, intOption("count", 20000));
+   checkEnergyPaths(check, viewsOf(bytes), rounds, random, "random bytes");
+   checkCorpusPaths(check, words, rounds, random);
+   checkFamilies(check, bytes, viewsOf(words), random);
+   checkThreads(check, viewsOf(words), random);
+   checkBatch(check, viewsOf(words), random);
+   checkSweep(check, viewsOf(words), random);
+   checkAttack(check, random);
+   check.endSection();
+
+   cout << "Check: " << check.passed << " passed, " << check.failed
+        << " failed" << endl;
+}
+
+/*************************************************************************
+ * fuzzInput
+ *
+ * Random bytes of the given length for the fuzz test, drawn from one
+ * of a few distributions chosen to hit what kernels get wrong: any
+ * byte, only bytes above 127 (negative as a char), only 0x80 and 0xff,
+ * zeros, and printable ASCII.
+ *************************************************************************/
+string fuzzInput(mt19937_64 &random, size_t length)
+{
+   string input(length, 0);
+   unsigned int kind = random() % 5;
+   for (size_t i = 0; i < length; i++)
+   {
+      uint64_t r = random();
+      if (kind == 0)
+         input[i] = (char) r;
+      else if (kind == 1)
+         input[i] = (char) (0x80 | r);
+      else if (kind == 2)
+         input[i] = (char) (r & 1 ? 0xff : 0x80);
+      else if (kind == 3)
+         input[i] = 0;
+      else
+         input[i] = (char) (32 + r % 95);
+   }
+   return input;
+}
+
+/*************************************************************************
+ * runFuzz
+ *
+ * Differential fuzzing of every hash kernel (see kernelMismatch): first
+ * every length from 0 to maxLength once, then `iterations` inputs of
+ * random length up to maxLength, mostly short (at most 64) like real
+ * keys.  Inputs are placed at
+ * every alignment.  Each mismatching input is reported and saved as
+ * fuzz-mismatch-N.bin; replay=FILE runs just the bytes of FILE.
+ *************************************************************************/
+void runFuzz()
+{
+   mt19937_64 random(intOption("seed", 1));
+   long iterations = intOption("iterations", 100000);
+   size_t maxLength = intOption("maxLength", 4096);
+
+   string replay = option("replay", "");
+   if (!replay.empty())
+   {
+      ifstream fin(replay.c_str(), ios::binary);
+      if (fin.fail())
+      {
+         cerr << "Error reading file " << replay << endl;
+         return;
+      }
+      string input((istreambuf_iterator<char>(fin)),
+                   istreambuf_iterator<char>());
+      string mismatch = kernelMismatch(input.data(), input.length(),
+                                       intOption("seed", 1));
+      cout << replay << " (" << input.length() << " bytes): "
+           << (mismatch.empty() ? "all kernels agree" : mismatch) << endl;
+      return;
+   }
+
+   vector<char> buffer(maxLength + 8);
+   size_t maxShort = min<size_t>(maxLength, 64);
+   long inputs = 0, mismatches = 0;
+   for (long i = 0; i <= (long) maxLength + iterations; i++)
+   {
+      size_t length = i <= (long) maxLength ? i
+                    : random() % 4 ? random() % (maxShort + 1)
+                    : random() % (maxLength + 1);
+      string input = fuzzInput(random, length);
+      char *at = &buffer[i % 8];
+      memcpy(at, input.data(), length);
+      string mismatch = kernelMismatch(at, length, random());
+      inputs++;
+      if (mismatch.empty())
+         continue;
+
+      mismatches++;
+      string file = "fuzz-mismatch-" + to_string(mismatches) + ".bin";
+      ofstream(file.c_str(), ios::binary).write(input.data(), length);
+      cout << "MISMATCH at " << length << " bytes (saved as " << file
+           << "): " << mismatch << endl;
+      if (mismatches >= intOption("maxMismatches", 10))
+         break;
+   }
+   cout << "Fuzz: " << inputs << " inputs, " << mismatches << " mismatches"
+        << endl;
+}
+
+/*************************************************************************
+ * runOne
+ *
+ * Runs one test, then prints where its time went (stats=0 turns that
+ * off; statsJson=FILE also appends it to FILE as JSON).  With
+ * trace=FILE, FILE is rewritten after each test with a Chrome trace of
+ * everything so far.  Arguments of
+ * the form name=value set an option for the tests that follow instead.
+ *************************************************************************/
+void runOne(string test)
+{
+   size_t equals = test.find('=');
+   if (equals != string::npos)
+   {
+      options[test.substr(0, equals)] = test.substr(equals + 1);
+      return;
+   }
+
+   resetPhaseStats();
+   string trace = option("trace", "");
+   if (!trace.empty())
+   {
+      threadTrace();     // the main thread is always the first
+      startTracing();
+   }
+   Clock::time_point start = Clock::now();
+   if (test == "bench")
+      runBench();
+   else if (test == "corpus")
+      runCorpus();
+   else if (test == "dedup")
+      runDedup();
+   else if (test == "gen")
+      runGenerate();
+   else if (test == "stream")
+      runStream();
+   else if (test == "wide")
+      runWide();
+   else if (test == "families")
+      runFamilies();
+   else if (test == "mphf")
+      runMphf();
+   else if (test == "perf")
+      runPerf();
+   else if (test == "anneal")
+      runAnneal();
+   else if (test == "evolve")
+      runEvolve();
+   else if (test == "sweep")
+      runSweep();
+   else if (test == "emit")
+      runEmit();
+   else if (test == "attack")
+      runAttack();
+   else if (test == "anneal-bench")
+      runAnnealBench();
+   else if (test == "check")
+      runCheck();
+   else if (test == "fuzz")
+      runFuzz();
+   else
+   {
+      cerr << "Unknown test: " << test << endl;
+      return;
+   }
+   if (intOption("stats", 1))
+      reportPhaseStats(test, nanosSince(start), option("statsJson", ""));
+   if (!trace.empty())
+      writeTrace(trace);
 }
 
 /*************************************************************************
@@ -234,6 +2356,87 @@ void runAll()
 void usage(const char * programName)
 {
    cout << "How to use it..." << endl;
+   cout << "   " << programName << " all" << endl;
+   cout << "      hash the words file and report the average collisions"
+        << endl;
+   cout << "   " << programName << " [name=value ...] test ..." << endl;
+   cout << "      words=FILE reads a text or binary corpus; generate=KIND"
+        << " count=N seed=S" << endl;
+   cout << "      builds one in memory instead (see gen); distinct=1 scores"
+        << " each word once" << endl;
+   cout << "      each test ends with a per-phase time summary on stderr"
+        << " (stats=0 statsJson=FILE)" << endl;
+   cout << "      trace=FILE writes a Chrome trace of every phase to FILE"
+        << endl;
+   cout << "      bench   micro-benchmark hashCode, safteyHash and calcEnergy"
+        << endl;
+   cout << "              (words=words warmup=3 reps=21 energyReps=5"
+        << " out=bench.csv)" << endl;
+   cout << "      corpus  load the corpus and report its size and"
+        << " duplicates" << endl;
+   cout << "      dedup   separate duplicated words from true collisions"
+        << endl;
+   cout << "      gen     stream a synthetic corpus to a binary corpus file"
+        << endl;
+   cout << "              (kind=random|url|numeric|prefix|adversarial"
+        << " count=1000000 seed=1 out=corpus.bin)" << endl;
+   cout << "      stream  energy of a corpus file too large to load,"
+        << " read in chunks" << endl;
+   cout << "              (words=words chunk=8388608)" << endl;
+   cout << "      wide    collision rates of each family's full-width"
+        << " output using a bitmap and sketches" << endl;
+   cout << "              (family=<all> seed=1|random chunkBits=0 hllBits=14"
+        << " kmv=1024)" << endl;
+   cout << "      families" << endl;
+   cout << "              energy and ns/word of every hash family, keyed"
+        << " ones against poly32" << endl;
+   cout << "              (seed=1|random warmup=1 reps=5)" << endl;
+   cout << "      mphf    build a minimal perfect hash of the distinct words"
+        << endl;
+   cout << "              (threads=<cores> partitionSize=100000 c=5 seed=1"
+        << " reps=5)" << endl;
+   cout << "      perf    hardware counters (IPC, cache and branch misses per"
+        << " word) via perf_event_open" << endl;
+   cout << "              (steps=10 seed=1)" << endl;
+   cout << "      anneal  anneal the hash constants on the words file"
+        << endl;
+   cout << "              (words=words steps=1000 seed=1)" << endl;
+   cout << "      evolve  genetic search of the hash constants, a generation"
+        << " at a time on every core" << endl;
+   cout << "              (words=words generations=50 population=64 seed=1"
+        << " threads=<cores> compare=0)" << endl;
+   cout << "      sweep   every odd multiplier below 2^bits, or every value"
+        << " of some shifts, top K kept" << endl;
+   cout << "              (space=multipliers|shifts bits=16 vary=01"
+        << " multiplier=31 shifts=20/12/7/4" << endl;
+   cout << "               top=10 batch=256 limit=<all>"
+        << " checkpoint=sweep.checkpoint discard=0" << endl;
+   cout << "               threads=<cores>)" << endl;
+   cout << "      emit    anneal, then write the best hash as a constexpr"
+        << " C++ header" << endl;
+   cout << "              (steps=1000 seed=1 samples=5 namespace=tuned_hash"
+        << " out=tuned_hash.h)" << endl;
+   cout << "              all three take adversarial=W to add W times the"
+        << " short-swap score to the energy" << endl;
+   cout << "      attack  colliding keys against a hash and how much they"
+        << " slow a table" << endl;
+   cout << "              (family=<none> multiplier=31 keys=4096"
+        << " blockLength=6 budget=4194304" << endl;
+   cout << "               bruteKeys=32 bruteBudget=16777216 seed=1"
+        << " victimSeed=<seed> threads=<cores>)" << endl;
+   cout << "      anneal-bench" << endl;
+   cout << "              annealing steps/s at 1, 2, 4 ... threads, steps"
+        << " per chain" << endl;
+   cout << "              (words=words steps=64 seed=1 threads=<cores>"
+        << " out=scaling.csv)" << endl;
+   cout << "      check   golden values and differential tests of every"
+        << " optimized path" << endl;
+   cout << "              (words=words hashed=hashed seed=1 rounds=8"
+        << " count=20000)" << endl;
+   cout << "      fuzz    differential fuzzing of every hash kernel on random"
+        << " bytes" << endl;
+   cout << "              (seed=1 iterations=100000 maxLength=4096"
+        << " maxMismatches=10 replay=FILE)" << endl;
 }
 
 /*************************************************************************
@@ -0,0 +1,56 @@
+/*************************************************************************
+ * Hash
+ *
+ * hashCode, safteyHash and HashParams; see goodness/hash.h.
+ *************************************************************************/
+#include "goodness/hash.h"
+
+using namespace std;
+
+namespace goodness
+{
+string toUnsignedString(unsigned int i)
+{
+   char buf[32];
+   int charPos = 32;
+   int shift = 1;
+   int radix = 1 << shift;
+   int mask = radix - 1;
+   do
+   {
+      buf[--charPos] = '0' + (i & mask);
+      i >>= shift;
+   }
+   while (i != 0);
+   while (charPos > 0)
+      buf[--charPos] = '0';
+   return string(buf, 32);
+}
+
+int safteyHash(unsigned int h)
+{
+    // This function ensures that hashCodes that differ only by
+    // constant multiples at each bit position have a bounded
+    // number of collisions (approximately 8 at default load factor).
+    h = h ^ (h >> 20) ^ (h >> 12);
+    return h ^ (h >> 7) ^ (h >> 4);
+}
+
+unsigned int hashCode(string &word)
+{
+   unsigned int h = 0;
+   for (int i = 0; i < word.length(); i++)
+   {
+      h = 31 * h + word[i]; // GOOD
+   }
+
+   return h % HASH_SIZE;
+}
+
+ostream &operator<<(ostream &out, const HashParams &params)
+{
+   return out << "multiplier=" << params.multiplier
+              << " shifts=" << params.shifts[0] << '/' << params.shifts[1]
+              << '/' << params.shifts[2] << '/' << params.shifts[3];
+}
+}
@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Anneal
+ *
+ * Simulated annealing of HashParams: start from a state, repeatedly
+ * try a random neighbour, always move to a better one and to a worse
+ * one with probability exp(-dE / T), where T(n) = 100 / n, and keep
+ * the best state seen.
+ *************************************************************************/
+#ifndef GOODNESS_ANNEAL_H
+#define GOODNESS_ANNEAL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "goodness/energy.h"
+#include "goodness/hash.h"
+#include "goodness/instrument.h"
+
+namespace goodness
+{
+/*************************************************************************
+ * neighbour
+ *
+ * A randomly chosen neighbouring state: either one bit of the
+ * multiplier flipped or one shift moved by one (kept within 1..31).
+ *************************************************************************/
+HashParams neighbour(const HashParams &state, std::mt19937 &random);
+
+/*************************************************************************
+ * AnnealProgress
+ *
+ * A running chain's latest numbers, published with relaxed atomic
+ * stores every step so that a ProgressReporter can read them without
+ * the chain ever waiting on it.
+ *************************************************************************/
+struct AnnealProgress
+{
+   std::atomic<long> iteration;
+   std::atomic<long> steps;
+   std::atomic<long> accepted;
+   std::atomic<double> temperature;
+   std::atomic<double> energy;
+   std::atomic<double> bestEnergy;
+
+   AnnealProgress() : iteration(0), steps(0), accepted(0), temperature(0),
+                      energy(0), bestEnergy(0) {}
+
+   void publish(long k, long total, long acceptedSoFar, double t,
+                double current, double best)
+   {
+      iteration.store(k, std::memory_order_relaxed);
+      steps.store(total, std::memory_order_relaxed);
+      accepted.store(acceptedSoFar, std::memory_order_relaxed);
+      temperature.store(t, std::memory_order_relaxed);
+      energy.store(current, std::memory_order_relaxed);
+      bestEnergy.store(best, std::memory_order_relaxed);
+   }
+};
+
+struct AnnealResult
+{
+   HashParams best;
+   double bestEnergy;
+   long evaluations;
+   long accepted;
+   long wordsHashed;
+};
+
+/*************************************************************************
+ * Annealer
+ *
+ * One annealing chain over a fixed list of words, for callers that
+ * re-tune in process: build it once (laying the words out costs about
+ * as much as one evaluation) and call run() whenever the parameters
+ * should be searched again.  Successive runs continue the same random
+ * stream, so the same seed and the same calls always give the same
+ * searches.  The words must outlive the Annealer; each thread needs
+ * its own.
+ *************************************************************************/
+class Annealer
+{
+public:
+   Annealer(const std::vector<std::string_view> &words, unsigned int seed)
+      : energy(words), random(seed), progress(NULL) {}
+
+   // where the chain publishes its state after every step, or NULL
+   void setProgress(AnnealProgress *progress) { this->progress = progress; }
+
+   // see EnergyFunction::setAdversarialWeight
+   void setAdversarialWeight(double weight)
+   {
+      energy.setAdversarialWeight(weight);
+   }
+
+   // exactly `steps` iterations starting from `start`
+   AnnealResult run(long steps, const HashParams &start = HashParams());
+
+   // the energy of a state on this Annealer's words
+   double evaluate(const HashParams &params) { return energy(params); }
+
+private:
+   EnergyFunction energy;
+   std::mt19937 random;
+   AnnealProgress *progress;
+};
+
+/*************************************************************************
+ * anneal
+ *
+ * One run of a fresh Annealer from the default parameters: the same
+ * seed always gives the same search.
+ *************************************************************************/
+AnnealResult anneal(const std::vector<std::string_view> &words, long steps,
+                    unsigned int seed, AnnealProgress *progress = NULL);
+
+/*************************************************************************
+ * ProgressReporter
+ *
+ * A thread that, every `interval` seconds until stop(), reads each
+ * chain's AnnealProgress and writes a snapshot line per chain to stderr
+ * and, if `file` is given, appends it there as CSV (or as JSON lines
+ * when the name ends in ".jsonl").  It does nothing if the interval is
+ * not positive and there is no file.
+ *************************************************************************/
+class ProgressReporter
+{
+public:
+   ProgressReporter(const std::vector<AnnealProgress> &chains,
+                    double interval, const std::string &file);
+   ~ProgressReporter() { stop(); }
+
+   // writes a final snapshot and waits for the thread to finish
+   void stop();
+
+private:
+   void run();
+   void snapshot();
+
+   const std::vector<AnnealProgress> &chains;
+   double interval;
+   bool json;
+   std::ofstream out;
+
+   std::mutex wakeLock;
+   std::condition_variable wake;
+   bool stopping;
+   std::thread reporter;
+
+   std::vector<long> lastEvaluations;
+   Clock::time_point start;
+   Clock::time_point last;
+};
+}
+
+#endif // GOODNESS_ANNEAL_H
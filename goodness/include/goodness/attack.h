@@ -0,0 +1,98 @@
+/*************************************************************************
+ * Attack
+ *
+ * Keys an attacker would choose against a hash: many distinct keys that
+ * all land in the same table slot.
+ *
+ * A polynomial hash composes.  If two blocks of the same length have
+ * the same full-width hash, swapping one for the other anywhere in a
+ * key keeps the key's hash, so k such pairs give 2^k colliding keys
+ * ("Aa" and "BB" under 31 are the classic pair).  A CRC composes the
+ * same way, since it is linear.  findCollidingBlocks looks for these
+ * pairs with a birthday search on several threads.  bruteForceKeys is
+ * the generic attack that works on any hash: it tries random keys
+ * until enough of them land in one slot.
+ *************************************************************************/
+#ifndef GOODNESS_ATTACK_H
+#define GOODNESS_ATTACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "goodness/families.h"
+#include "goodness/hash.h"
+
+namespace goodness
+{
+// a hash under attack: a hash family with its seed, or, when family is
+// NULL, hashWith and fullHashWith with the given HashParams
+struct AttackTarget
+{
+   const HashFamily *family;
+   HashParams params;
+   uint64_t seed;
+
+   AttackTarget(const HashParams &params)
+      : family(NULL), params(params), seed(0) {}
+   AttackTarget(const HashFamily &family, uint64_t seed)
+      : family(&family), seed(seed) {}
+
+   uint64_t full(std::string_view key) const
+   {
+      return family ? family->hash(key.data(), key.length(), seed)
+                    : fullHashWith(params, key);
+   }
+
+   unsigned int index(std::string_view key) const
+   {
+      return family ? reduceHash(full(key), family->bits)
+                    : hashWith(params, key);
+   }
+
+   std::string name() const;
+};
+
+struct BlockPair
+{
+   std::string first;
+   std::string second;
+};
+
+// up to `count` pairs of distinct printable blocks of `length` (at most
+// 8) characters with equal full hashes, from `budget` random blocks
+// hashed on `threads` threads; `tried` is set to the blocks hashed.
+std::vector<BlockPair> findCollidingBlocks(const AttackTarget &target,
+                                           size_t count, size_t length,
+                                           int threads, uint64_t seed,
+                                           uint64_t budget, uint64_t *tried);
+
+// the first `count` keys made by choosing one block of every pair
+std::vector<std::string> blockKeys(const std::vector<BlockPair> &pairs,
+                                   size_t count);
+
+// up to `count` random printable keys with the index of the first key
+// tried, from at most `budget` keys per thread; `tried` is set to the
+// keys hashed
+std::vector<std::string> bruteForceKeys(const AttackTarget &target,
+                                        size_t count, int threads,
+                                        uint64_t seed, uint64_t budget,
+                                        uint64_t *tried);
+
+/*************************************************************************
+ * adversarialPartners
+ *
+ * The average number of other printable strings of the same `length`
+ * (at most 3) that have the same full 32-bit hashWith as a given one.
+ * These short swaps, like "Aa" for "BB", are what a block attack is
+ * built from.  The count comes from the difference vectors d, with
+ * every |d[i]| <= 94, for which sum d[i] * m^(length-1-i) == 0 mod
+ * 2^32; no strings are hashed.  It is zero for most multipliers that
+ * are not small.
+ *************************************************************************/
+double adversarialPartners(const HashParams &params, int length);
+}
+
+#endif // GOODNESS_ATTACK_H
@@ -0,0 +1,190 @@
+/*************************************************************************
+ * Corpus
+ *
+ * The words hashes are scored on: read from text or binary corpus
+ * files or generated synthetically, interned, and laid out for the
+ * different hashing kernels.
+ *************************************************************************/
+#ifndef GOODNESS_CORPUS_H
+#define GOODNESS_CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "goodness/hash.h"
+
+namespace goodness
+{
+/*************************************************************************
+ * Binary corpus format
+ *
+ * An 8-byte magic "GDNSCRP1", a little-endian 64-bit word count, then
+ * each word as a 32-bit length followed by its bytes.  Unlike the text
+ * format it can hold words containing whitespace.
+ *************************************************************************/
+extern const char CORPUS_MAGIC[8];
+
+void writeCorpusHeader(std::ostream &out, unsigned long long count);
+void writeCorpusWord(std::ostream &out, const std::string &word);
+
+// true (and positioned after the magic) if `in` is a binary corpus,
+// otherwise rewound to the start
+bool isBinaryCorpus(std::istream &in);
+
+/*************************************************************************
+ * Corpus
+ *
+ * The words of a corpus, interned.  Each distinct word is stored once,
+ * its bytes bump-allocated in large slabs that never move, so the
+ * string_views handed out stay valid for the life of the Corpus.  An
+ * open-addressing table of word ids finds duplicates as words are
+ * added.  words() is the corpus in its original order, duplicates
+ * included; distinctWords() has each word once.
+ *************************************************************************/
+class Corpus
+{
+public:
+   Corpus() : slabUsed(SLAB_SIZE), table(1024, EMPTY) {}
+
+   // adds the next word of the corpus, returning its id
+   uint32_t add(std::string_view word);
+
+   // reads a text or binary corpus file; false if it cannot be opened,
+   // or if a binary one ends before all its words
+   bool load(std::string file);
+
+   void reserve(size_t count)
+   {
+      sequence.reserve(count);
+      ids.reserve(count);
+   }
+
+   const std::vector<std::string_view> &words() const { return sequence; }
+   const std::vector<std::string_view> &distinctWords() const
+   {
+      return unique;
+   }
+   const std::vector<uint32_t> &wordIds() const { return ids; }
+   size_t size() const { return sequence.size(); }
+   size_t distinct() const { return unique.size(); }
+   size_t bytes() const;
+
+private:
+   static constexpr size_t SLAB_SIZE = 1 << 20;
+   static constexpr uint32_t EMPTY = 0xffffffff;
+
+   std::string_view store(std::string_view word);
+   void grow();
+
+   std::vector<std::unique_ptr<char[]> > slabs;
+   std::vector<std::unique_ptr<char[]> > large;
+   size_t slabUsed;
+   std::vector<std::string_view> unique;    // by id
+   std::vector<uint64_t> hashes;            // by id, for growing the table
+   std::vector<uint32_t> table;
+   std::vector<uint32_t> ids;               // corpus order
+   std::vector<std::string_view> sequence;  // corpus order
+};
+
+/*************************************************************************
+ * CorpusGenerator
+ *
+ * Produces a deterministic (by seed) stream of synthetic words of one
+ * kind, for measuring hashes on corpora far larger than the words file:
+ *    random       printable ASCII, 1 to 16 characters
+ *    url          https://host/path?id=n style URLs
+ *    numeric      consecutive decimal IDs from a random base
+ *    prefix       a long shared prefix plus a short random suffix
+ *    adversarial  distinct concatenations of "Aa" and "BB", which all
+ *                 have the same (unreduced) polynomial hash with 31
+ *************************************************************************/
+class CorpusGenerator
+{
+public:
+   CorpusGenerator(std::string kind, unsigned long long count,
+                   unsigned long long seed);
+
+   bool valid() const;
+   bool done() const { return index >= count; }
+   std::string next();
+
+private:
+   std::string lowercase(int length);
+
+   std::string kind;
+   unsigned long long count;
+   unsigned long long index;
+   unsigned long long base;
+   unsigned long long mask;
+   int blocks;
+   std::mt19937_64 random;
+};
+
+/*************************************************************************
+ * PaddedCorpus
+ *
+ * All the words in one buffer, each starting on an 8-byte boundary and
+ * followed by at least 8 zero bytes, so word-at-a-time kernels may load
+ * a whole word past the end of any entry.
+ *************************************************************************/
+struct PaddedCorpus
+{
+   std::vector<char> bytes;
+   std::vector<size_t> offsets;
+   std::vector<uint32_t> lengths;
+
+   PaddedCorpus(const std::vector<std::string_view> &words);
+
+   size_t size() const { return offsets.size(); }
+   const char *data(size_t i) const { return &bytes[offsets[i]]; }
+};
+
+/*************************************************************************
+ * LengthBuckets
+ *
+ * The corpus reorganized for lane-parallel hashing.  Words are grouped
+ * by length; each group is stored transposed, one row per character
+ * position with the group's words side by side (padded to a multiple
+ * of LANES), so hashWith can be run on a whole row at once without
+ * masking.  `index` records where each word was in the original list,
+ * and hashAll returns hashes in that original order.  Words longer
+ * than MAX_LENGTH are rare enough to be hashed one at a time.
+ *************************************************************************/
+class LengthBuckets
+{
+public:
+   static const size_t LANES = 32;
+   static const size_t MAX_LENGTH = 64;
+
+   LengthBuckets(const std::vector<std::string_view> &words);
+
+   size_t size() const { return count; }
+
+   // hashWith of every word, in original order
+   void hashAll(const HashParams &params, std::vector<unsigned int> &hashes,
+                std::vector<uint32_t> &lanes) const;
+
+private:
+   struct Bucket
+   {
+      size_t length;
+      size_t lanes;
+      std::vector<int8_t> matrix;
+      std::vector<uint32_t> index;
+   };
+
+   size_t count;
+   std::vector<Bucket> buckets;
+   std::vector<uint32_t> longIndex;
+   std::vector<std::string_view> longWords;
+};
+}
+
+#endif // GOODNESS_CORPUS_H
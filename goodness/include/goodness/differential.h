@@ -0,0 +1,31 @@
+/*************************************************************************
+ * Differential
+ *
+ * Every specialized hash kernel run on one input and compared with the
+ * reference it must equal, for the fuzz test and the libFuzzer entry
+ * point.  The reference for the polynomial hashes takes every byte as
+ * signed, as hashCode does where it was written (x86), whatever the
+ * platform's char is: a kernel that loads bytes unsigned, or a char
+ * that is unsigned (ARM, POWER), shows up as a mismatch on any byte
+ * above 127.
+ *************************************************************************/
+#ifndef GOODNESS_DIFFERENTIAL_H
+#define GOODNESS_DIFFERENTIAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace goodness
+{
+// the polynomial of hashCode, unreduced, with bytes taken as int8_t
+uint32_t signedPolyHash(const char *data, size_t length,
+                        uint32_t multiplier);
+
+// empty if every kernel agrees with its reference on these bytes,
+// otherwise what disagreed first; `seed` picks the keyed families' seed
+// and the multiplier tried on the lane-parallel path
+std::string kernelMismatch(const char *data, size_t length, uint64_t seed);
+}
+
+#endif // GOODNESS_DIFFERENTIAL_H
@@ -0,0 +1,36 @@
+/*************************************************************************
+ * Emit
+ *
+ * Turning tuned parameters into code another program can compile.
+ *************************************************************************/
+#ifndef GOODNESS_EMIT_H
+#define GOODNESS_EMIT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "goodness/hash.h"
+
+namespace goodness
+{
+/*************************************************************************
+ * cString
+ *
+ * A word written as a C++ string literal.
+ *************************************************************************/
+std::string cString(const std::string &word);
+
+/*************************************************************************
+ * writeHashHeader
+ *
+ * Writes a self-contained header with the given parameters baked into
+ * constexpr functions, plus static_asserts that check them against
+ * hashes of a few corpus words computed here.
+ *************************************************************************/
+void writeHashHeader(std::ostream &out, const HashParams &params,
+                     double energy, const std::vector<std::string> &samples,
+                     const std::string &space);
+}
+
+#endif // GOODNESS_EMIT_H
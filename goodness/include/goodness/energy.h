@@ -0,0 +1,258 @@
+/*************************************************************************
+ * Energy
+ *
+ * The energy of a hash is what calcEnergy reports for a corpus hashed
+ * with it: the average number of collisions per occupied slot once
+ * colliding words have been moved by safteyHash.  calcEnergy and
+ * hashFile are the original file-based versions; the rest compute the
+ * same number in memory, from a stream, or for another hash family.
+ *************************************************************************/
+#ifndef GOODNESS_ENERGY_H
+#define GOODNESS_ENERGY_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "goodness/attack.h"
+#include "goodness/corpus.h"
+#include "goodness/families.h"
+#include "goodness/hash.h"
+
+namespace goodness
+{
+/*************************************************************************
+ * calcEnergy
+ *
+ * The average number of collisions of the hash codes in a file, one per
+ * line, as written by hashFile; -1 if the file cannot be read.
+ *************************************************************************/
+double calcEnergy(std::string filename);
+
+/*************************************************************************
+ * hashFile
+ *
+ * Get the hash code of each word in the file and output as 'hashed'
+ *************************************************************************/
+void hashFile(std::string file);
+
+/*************************************************************************
+ * Histogram
+ *
+ * The collision record of calcEnergy kept as a flat array indexed by
+ * hash value instead of a map.  A count of -1 means "not present", and
+ * the touched slots are remembered so the next evaluation only has to
+ * reset those.
+ *************************************************************************/
+struct Histogram
+{
+   std::vector<int> counts;
+   std::vector<unsigned int> touched;
+
+   Histogram() : counts(HASH_SIZE, -1) {}
+
+   void clear()
+   {
+      for (size_t i = 0; i < touched.size(); i++)
+         counts[touched[i]] = -1;
+      touched.clear();
+   }
+
+   // the same bookkeeping calcEnergy does for one hashed value
+   void add(const HashParams &params, unsigned int h)
+   {
+      if (counts[h] < 0)
+      {
+         counts[h] = 0;
+         touched.push_back(h);
+         return;
+      }
+      h = safteyHashWith(params, h);
+      if (counts[h] < 0)
+      {
+         counts[h] = 0;
+         touched.push_back(h);
+      }
+      else
+         counts[h]++;
+   }
+
+   double average() const
+   {
+      double average = 0;
+      for (size_t i = 0; i < touched.size(); i++)
+         average += counts[touched[i]];
+      return average / (double) touched.size();
+   }
+};
+
+/*************************************************************************
+ * energyOf
+ *
+ * The energy of a state: what calcEnergy would report for the words
+ * hashed with these parameters, computed in memory.
+ *************************************************************************/
+double energyOf(const HashParams &params,
+                const std::vector<std::string_view> &words,
+                Histogram &histogram);
+
+/*************************************************************************
+ * familyEnergy
+ *
+ * energyOf for a hash family: calcEnergy's average for the words hashed
+ * by the family, reduced to HASH_SIZE and chained with safteyHash.
+ *************************************************************************/
+double familyEnergy(const HashFamily &family, uint64_t seed,
+                    const std::vector<std::string_view> &words,
+                    Histogram &histogram);
+
+/*************************************************************************
+ * bucketEnergyOf
+ *
+ * energyOf computed from LengthBuckets: the words are hashed lane-
+ * parallel, then fed to the histogram in their original order, since
+ * which of two colliding words gets rehashed depends on that order.
+ *************************************************************************/
+struct EnergyScratch
+{
+   Histogram histogram;
+   std::vector<unsigned int> hashes;
+   std::vector<uint32_t> lanes;
+};
+
+double bucketEnergyOf(const HashParams &params, const LengthBuckets &buckets,
+                      EnergyScratch &scratch);
+
+/*************************************************************************
+ * EnergyFunction
+ *
+ * The energy of any state on one fixed list of words, the way the
+ * annealer scores them: the words are laid out in LengthBuckets once
+ * and every call reuses the same scratch space.  The words must outlive
+ * it.  Not safe to call from two threads at once; give each its own.
+ *************************************************************************/
+class EnergyFunction
+{
+public:
+   EnergyFunction(const std::vector<std::string_view> &words)
+      : buckets(words), adversarialWeight(0) {}
+
+   double operator()(const HashParams &params)
+   {
+      double energy = bucketEnergyOf(params, buckets, scratch);
+      if (adversarialWeight > 0)
+         energy += adversarialWeight * adversarialPartners(params, 3);
+      return energy;
+   }
+
+   // adds `weight` times adversarialPartners(params, 3) to every energy,
+   // so a search is pushed away from multipliers an attacker can build
+   // colliding keys for; 0, the default, leaves calcEnergy's number
+   void setAdversarialWeight(double weight) { adversarialWeight = weight; }
+
+   // the number of words each evaluation hashes
+   size_t size() const { return buckets.size(); }
+
+private:
+   LengthBuckets buckets;
+   EnergyScratch scratch;
+   double adversarialWeight;
+};
+
+/*************************************************************************
+ * BatchEnergy
+ *
+ * The energies of many states at once, for searches that score a
+ * whole population per step.  The words are laid out in LengthBuckets
+ * once and shared by `threads` threads, each with its own scratch, and
+ * candidates that share a multiplier are hashed once per thread: only
+ * the histogram pass is repeated for their shifts.  Each energy is exactly
+ * what EnergyFunction gives for that state.  The worker threads are
+ * started once, in the constructor, and wait for each batch; the
+ * calling thread works on every batch too.
+ *************************************************************************/
+class BatchEnergy
+{
+public:
+   BatchEnergy(const std::vector<std::string_view> &words, int threads);
+   ~BatchEnergy();
+
+   // energies[i] is the energy of candidates[i]
+   void operator()(const std::vector<HashParams> &candidates,
+                   std::vector<double> &energies);
+
+   // see EnergyFunction::setAdversarialWeight
+   void setAdversarialWeight(double weight) { adversarialWeight = weight; }
+
+   // the number of words each evaluation hashes
+   size_t size() const { return buckets.size(); }
+   int threads() const { return (int) scratch.size(); }
+
+private:
+   void serve(size_t worker);
+
+   LengthBuckets buckets;
+   std::vector<EnergyScratch> scratch;
+   double adversarialWeight;
+
+   // the pool: each batch sets `job`, bumps `round` and wakes the
+   // workers, then waits until `running` is back to zero
+   std::mutex poolLock;
+   std::condition_variable wake;
+   std::condition_variable finished;
+   const std::function<void(EnergyScratch &)> *job;
+   unsigned long round;
+   size_t running;
+   bool stopping;
+   std::vector<std::thread> workers;
+};
+
+/*************************************************************************
+ * dedupEnergy
+ *
+ * calcEnergy's average for the whole corpus and for its distinct words,
+ * from one pass over the words.  The Corpus already knows which words
+ * repeat an earlier one (ids are handed out in order of first
+ * appearance), so every collision can be put down either to a true
+ * collision between different words or to a duplicated word.
+ *************************************************************************/
+struct DedupEnergy
+{
+   double energy;               // as calcEnergy, duplicates included
+   double distinctEnergy;       // distinct words only
+   size_t duplicates;           // words repeating an earlier word
+   long collisions;             // total of the collision counts
+   long trueCollisions;         // the same, distinct words only
+};
+
+DedupEnergy dedupEnergy(const HashParams &params, const Corpus &corpus,
+                        Histogram &all, Histogram &distinct);
+
+/*************************************************************************
+ * streamEnergy
+ *
+ * energyOf for corpora larger than memory.  The file is read in chunks
+ * of `chunkBytes` (at least 1) into two buffers: while one is being hashed the next
+ * read is already running on another thread.  Each word is hashed as
+ * its bytes go by, so words split across chunks need no copying and
+ * only the histogram stays resident.  The energy is -1 if the file
+ * cannot be read.
+ *************************************************************************/
+struct StreamResult
+{
+   double energy;
+   unsigned long long words;
+   unsigned long long bytes;
+};
+
+StreamResult streamEnergy(const HashParams &params, std::string file,
+                          size_t chunkBytes, Histogram &histogram);
+}
+
+#endif // GOODNESS_ENERGY_H
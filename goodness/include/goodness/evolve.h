@@ -0,0 +1,68 @@
+/*************************************************************************
+ * Evolve
+ *
+ * A genetic search over HashParams, run alongside annealing.  A whole
+ * population is scored at once with BatchEnergy, so a generation keeps
+ * every core busy where one annealing chain can only use one.  The
+ * best eighth of each generation survives unchanged.  The rest of the
+ * next generation are children of two parents, each picked as the
+ * best of three at random.  A child takes every bit of its multiplier
+ * and every shift from either parent, then a few neighbour() steps.
+ *************************************************************************/
+#ifndef GOODNESS_EVOLVE_H
+#define GOODNESS_EVOLVE_H
+
+#include <cstddef>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "goodness/energy.h"
+#include "goodness/hash.h"
+
+namespace goodness
+{
+struct EvolveResult
+{
+   HashParams best;
+   double bestEnergy;
+   long generations;
+   long evaluations;
+   long wordsHashed;
+};
+
+/*************************************************************************
+ * Evolver
+ *
+ * The population search over a fixed list of words on `threads`
+ * threads.  Every random choice is made on the calling thread, so the
+ * same seed gives the same search on any number of threads.  The
+ * words must outlive the Evolver.
+ *************************************************************************/
+class Evolver
+{
+public:
+   Evolver(const std::vector<std::string_view> &words, unsigned int seed,
+           int threads)
+      : energy(words, threads), random(seed) {}
+
+   // see EnergyFunction::setAdversarialWeight
+   void setAdversarialWeight(double weight)
+   {
+      energy.setAdversarialWeight(weight);
+   }
+
+   // `generations` generations of `population` states; the first
+   // generation is `start` and its mutants and random multipliers
+   EvolveResult run(long generations, size_t population,
+                    const HashParams &start = HashParams());
+
+private:
+   HashParams child(const std::vector<HashParams> &parents);
+
+   BatchEnergy energy;
+   std::mt19937 random;
+};
+}
+
+#endif // GOODNESS_EVOLVE_H
@@ -0,0 +1,120 @@
+/*************************************************************************
+ * Hash families
+ *
+ * Whole hash functions, as opposed to the constants of one, so that
+ * other designs and output widths can be scored by the same energy
+ * functions.  Each takes the bytes of a word and a seed (ignored by
+ * unkeyed families) and returns a `bits`-wide value in a uint64_t.
+ *
+ * crc32c is the Castagnoli CRC, eight bytes per crc32 instruction on
+ * CPUs with SSE4.2.  clmul64 folds each eight bytes into the state with
+ * a carry-less (GF(2)) multiply, using PCLMULQDQ when present, and ends
+ * with a non-linear finalizer since carry-less products are linear.
+ * The dispatching versions check the CPU once; the "-soft" versions are
+ * the portable fallbacks and must give bit-identical results.
+ *
+ * The word-at-a-time kernels consume eight bytes per step instead of
+ * one.  poly32-wide is byte-for-byte the Java-style hash: eight steps
+ * of h = 31 * h + c collapse into h * 31^8 plus each (signed) byte
+ * times its power of 31.  word64 is a new hash that folds each eight
+ * byte word into the state with one 64x64->128 multiply.  Both assume
+ * a little-endian load.  The plain versions load the final partial
+ * word with memcpy.  The "Padded" versions instead load a whole word
+ * and mask it, which is only legal on storage with at least 8 readable
+ * bytes after every word (see PaddedCorpus).
+ *
+ * The keyed families are the ones whose collisions depend on the seed,
+ * so an attacker who does not know it cannot choose colliding keys.
+ * siphash13 is SipHash-1-3 with a 128-bit key expanded from the seed:
+ * a PRF, and the slowest.  multishift32 is multilinear multiply-shift
+ * hashing (Lemire and Kaser): every 32 bits of the word is multiplied
+ * by its own 64-bit key and the high half of the sum is kept, which is
+ * strongly universal for each length.  wyhash64 follows wyhash: it
+ * folds 16 bytes per 64x64->128 multiply into a seeded state.  It is
+ * fast but has no proof, and some seed-independent collisions are
+ * known for hashes of its kind.  Take the seed from processSeed() so
+ * it differs in every process.
+ *************************************************************************/
+#ifndef GOODNESS_FAMILIES_H
+#define GOODNESS_FAMILIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "goodness/hash.h"
+
+namespace goodness
+{
+typedef uint64_t (*HashFunction)(const char *data, size_t length,
+                                 uint64_t seed);
+
+struct HashFamily
+{
+   const char *name;
+   int bits;
+   HashFunction hash;
+   bool keyed;                  // the output depends on the seed
+};
+
+// hashCode before reduction: Java's String.hashCode
+uint64_t polyHash32(const char *data, size_t length, uint64_t seed);
+// the same polynomial carried in 64 bits
+uint64_t polyHash64(const char *data, size_t length, uint64_t seed);
+// FNV-1a, 64-bit
+uint64_t fnv1aHash64(const char *data, size_t length, uint64_t seed);
+// add-multiply per byte with a final avalanche
+uint64_t multiplyHash64(const char *data, size_t length, uint64_t seed);
+// foldMultiply per byte
+uint64_t foldHash64(const char *data, size_t length, uint64_t seed);
+
+bool cpuHasCrc32();
+bool cpuHasClmul();
+
+uint64_t crc32cHash(const char *data, size_t length, uint64_t seed);
+uint64_t crc32cSoft(const char *data, size_t length, uint64_t seed);
+uint64_t clmulHash(const char *data, size_t length, uint64_t seed);
+uint64_t clmulHashSoft(const char *data, size_t length, uint64_t seed);
+
+uint64_t polyHash32Wide(const char *data, size_t length, uint64_t seed);
+uint64_t polyHash32Padded(const char *data, size_t length, uint64_t seed);
+uint64_t wordHash64(const char *data, size_t length, uint64_t seed);
+uint64_t wordHash64Padded(const char *data, size_t length, uint64_t seed);
+
+// SipHash with `compressionRounds` rounds per 8 bytes and
+// `finalRounds` at the end (SipHash-2-4 is 2, 4) and key k0, k1
+uint64_t sipHash(const char *data, size_t length, uint64_t k0, uint64_t k1,
+                 int compressionRounds, int finalRounds);
+uint64_t sipHash13(const char *data, size_t length, uint64_t seed);
+uint64_t multiShiftHash32(const char *data, size_t length, uint64_t seed);
+uint64_t wyHash64(const char *data, size_t length, uint64_t seed);
+
+// a seed drawn from std::random_device once per process
+uint64_t processSeed();
+
+extern const HashFamily hashFamilies[];
+extern const size_t numHashFamilies;
+
+// versions of families above that need PaddedCorpus storage
+extern const HashFamily paddedHashFamilies[];
+extern const size_t numPaddedHashFamilies;
+
+// the family called `name` in hashFamilies, or NULL
+const HashFamily *findHashFamily(const std::string &name);
+
+/*************************************************************************
+ * reduceHash
+ *
+ * Brings a family's output down to a table index.  32-bit outputs are
+ * reduced like hashCode so poly32 scores exactly like it; wider ones
+ * fold in their high half first.
+ *************************************************************************/
+inline unsigned int reduceHash(uint64_t h, int bits)
+{
+   if (bits > 32)
+      h ^= h >> 32;
+   return (uint32_t) h % HASH_SIZE;
+}
+}
+
+#endif // GOODNESS_FAMILIES_H
@@ -0,0 +1,40 @@
+/*************************************************************************
+ * libgoodness
+ *
+ * Everything the goodness program is built from, for programs that
+ * want to score or re-tune their hash in process:
+ *    hash.h          hashCode, safteyHash and the HashParams being tuned
+ *    families.h      other hash functions behind one HashFamily interface
+ *    corpus.h        loading, generating and laying out word lists
+ *    energy.h        the energy of a hash on a corpus (EnergyFunction)
+ *    anneal.h        the Annealer and its progress reporting
+ *    evolve.h        the genetic search, a generation at a time
+ *    sweep.h         exhaustive search of small spaces, resumable
+ *    attack.h        colliding keys an attacker would choose
+ *    sketch.h        exact and approximate distinct counts
+ *    differential.h  every hash kernel checked against its reference
+ *    mphf.h          a minimal perfect hash
+ *    emit.h          tuned parameters as a C++ header
+ *    perf.h          hardware counters
+ *    instrument.h    per-phase timers and tracing
+ * All of it lives in namespace goodness.
+ *************************************************************************/
+#ifndef GOODNESS_GOODNESS_H
+#define GOODNESS_GOODNESS_H
+
+#include "goodness/anneal.h"
+#include "goodness/attack.h"
+#include "goodness/corpus.h"
+#include "goodness/differential.h"
+#include "goodness/emit.h"
+#include "goodness/energy.h"
+#include "goodness/evolve.h"
+#include "goodness/families.h"
+#include "goodness/hash.h"
+#include "goodness/instrument.h"
+#include "goodness/mphf.h"
+#include "goodness/perf.h"
+#include "goodness/sketch.h"
+#include "goodness/sweep.h"
+
+#endif // GOODNESS_GOODNESS_H
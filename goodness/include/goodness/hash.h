@@ -0,0 +1,121 @@
+/*************************************************************************
+ * Hash
+ *
+ * The hash being tuned: hashCode, Java's String.hashCode reduced to a
+ * HASH_SIZE table, and safteyHash, the secondary hash applied to an
+ * occupied slot.  HashParams holds their constants so other values can
+ * be tried with hashWith and safteyHashWith.
+ *************************************************************************/
+#ifndef GOODNESS_HASH_H
+#define GOODNESS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace goodness
+{
+const unsigned int HASH_SIZE = 1048576;
+
+/**********************************************************************
+ * toUnsignedString
+ *  makes its integer argument into a 32-character bitstring (0s or 1s)
+ *  useful for debugging.
+ *********************************************************************/
+std::string toUnsignedString(unsigned int i);
+
+/*************************************************************************
+ * safteyHash
+ *
+ * Spreads a hash code that collided: codes that differ only by
+ * constant multiples at each bit position get a bounded number of
+ * collisions.
+ *************************************************************************/
+int safteyHash(unsigned int h);
+
+/**********************************************************************
+ * hashCode
+ *    returns an integer value of a string.
+ *    works like Java's String.hashCode(), which is computed as
+ *
+ *    s[0] * 31^(n-1) + s[1] * 31^(n-2) + ... + s[n-1]
+ *
+ *    using int arithmetic, where s[i] is the i'th character
+ *    of the string, n is the length of the string,
+ *    and ^ indicates exponentiation.
+ *    (The hash value of the empty string is zero.)
+ *********************************************************************/
+unsigned int hashCode(std::string &word);
+
+/*************************************************************************
+ * HashParams
+ *
+ * The state being annealed: the multiplier of the polynomial hashCode
+ * and the four shift constants of safteyHash.  The defaults reproduce
+ * hashCode and safteyHash exactly.
+ *************************************************************************/
+struct HashParams
+{
+   unsigned int multiplier;
+   int shifts[4];
+
+   HashParams() : multiplier(31)
+   {
+      shifts[0] = 20; shifts[1] = 12; shifts[2] = 7; shifts[3] = 4;
+   }
+};
+
+std::ostream &operator<<(std::ostream &out, const HashParams &params);
+
+/*************************************************************************
+ * hashWith / fullHashWith / safteyHashWith
+ *
+ * hashCode and safteyHash with the constants taken from a HashParams.
+ * fullHashWith is the hash before it is reduced to HASH_SIZE.
+ *************************************************************************/
+inline unsigned int fullHashWith(const HashParams &params,
+                                 std::string_view word)
+{
+   unsigned int h = 0;
+   for (size_t i = 0; i < word.length(); i++)
+      h = params.multiplier * h + word[i];
+   return h;
+}
+
+inline unsigned int hashWith(const HashParams &params, std::string_view word)
+{
+   return fullHashWith(params, word) % HASH_SIZE;
+}
+
+inline int safteyHashWith(const HashParams &params, unsigned int h)
+{
+   h = h ^ (h >> params.shifts[0]) ^ (h >> params.shifts[1]);
+   return h ^ (h >> params.shifts[2]) ^ (h >> params.shifts[3]);
+}
+
+/*************************************************************************
+ * mix64
+ *
+ * The splitmix64 finalizer.  It is a bijection, so distinct hash
+ * values stay distinct, but its output is uniform enough for sketches
+ * and table placement even when the hash being measured is not.
+ *************************************************************************/
+inline uint64_t mix64(uint64_t x)
+{
+   x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+   return x ^ (x >> 31);
+}
+
+// 128-bit product folded back to 64 bits, so every multiply mixes the
+// high half of the state into the low half
+inline uint64_t foldMultiply(uint64_t a, uint64_t b)
+{
+   unsigned __int128 product = (unsigned __int128) a * b;
+   return (uint64_t) product ^ (uint64_t) (product >> 64);
+}
+}
+
+#endif // GOODNESS_HASH_H
@@ -0,0 +1,170 @@
+/*************************************************************************
+ * Instrumentation
+ *
+ * Every run accounts its time to a few coarse phases.  A ScopedTimer
+ * adds the time it was alive (and optionally a count of items, such as
+ * words hashed) to the calling thread's own PhaseStats, so the hot path
+ * takes no locks; a lock is only taken the first time a thread records
+ * anything, to register its PhaseStats.  A thread that exits hands its
+ * PhaseStats (and trace buffer) on to the next thread started, so
+ * memory and the thread count reported follow the most threads alive
+ * at once, not every thread ever started.  Nested phases overlap:
+ * "energy" includes the "hash" and "histogram" it is made of.
+ *
+ * When tracing is started, every ScopedTimer and TraceScope also
+ * records a complete event (name, start, duration) in a ring buffer
+ * owned by its thread, registered the same way as PhaseStats, and
+ * writeTrace writes them all as Chrome trace JSON (load it in
+ * chrome://tracing or ui.perfetto.dev).  The buffers keep the newest
+ * TRACE_CAPACITY events per thread.  With tracing off, the only cost
+ * is one relaxed atomic load per scope.
+ *************************************************************************/
+#ifndef GOODNESS_INSTRUMENT_H
+#define GOODNESS_INSTRUMENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace goodness
+{
+typedef std::chrono::steady_clock Clock;
+
+double nanosSince(Clock::time_point start);
+
+enum Phase
+{
+   PHASE_LOAD,
+   PHASE_TOKENIZE,
+   PHASE_HASH,
+   PHASE_HISTOGRAM,
+   PHASE_ENERGY,
+   PHASE_ANNEAL_STEP,
+   NUM_PHASES
+};
+
+extern const char *phaseNames[NUM_PHASES];
+
+struct PhaseStats
+{
+   uint64_t nanos[NUM_PHASES];
+   uint64_t calls[NUM_PHASES];
+   uint64_t items[NUM_PHASES];
+
+   PhaseStats() { reset(); }
+
+   void reset()
+   {
+      for (int p = 0; p < NUM_PHASES; p++)
+         nanos[p] = calls[p] = items[p] = 0;
+   }
+};
+
+// the calling thread's stats, registered on first use
+PhaseStats &threadPhaseStats();
+
+// totals over all threads; only meaningful once they have finished
+PhaseStats totalPhaseStats(int *threads);
+void resetPhaseStats();
+
+/*************************************************************************
+ * reportPhaseStats
+ *
+ * Prints where a test's time went to stderr and, if `json` names a
+ * file, appends the same numbers there as one JSON object per line.
+ *************************************************************************/
+void reportPhaseStats(const std::string &test, double wallNanos,
+                      const std::string &json);
+
+const size_t TRACE_CAPACITY = 1 << 16;
+
+extern std::atomic<bool> tracing;
+extern Clock::time_point traceEpoch;
+
+struct TraceEvent
+{
+   const char *name;
+   int64_t start;       // ns since traceEpoch
+   int64_t duration;    // ns
+};
+
+struct ThreadTrace
+{
+   int id;
+   uint64_t written;
+   std::vector<TraceEvent> events;
+
+   ThreadTrace(int id) : id(id), written(0), events(TRACE_CAPACITY) {}
+
+   void record(const char *name, Clock::time_point start,
+               Clock::time_point end)
+   {
+      TraceEvent &event = events[written++ % TRACE_CAPACITY];
+      event.name = name;
+      event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       start - traceEpoch).count();
+      event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          end - start).count();
+   }
+};
+
+// the calling thread's trace buffer; the first thread to ask is id 0
+ThreadTrace &threadTrace();
+void startTracing();
+
+/*************************************************************************
+ * writeTrace
+ *
+ * Writes every recorded event as Chrome trace JSON.  Call only while no
+ * other thread is recording.
+ *************************************************************************/
+void writeTrace(const std::string &file);
+
+// a traced region that is not one of the timed phases
+class TraceScope
+{
+public:
+   TraceScope(const char *name) : name(name), start(Clock::now()) {}
+
+   ~TraceScope()
+   {
+      if (tracing.load(std::memory_order_relaxed))
+         threadTrace().record(name, start, Clock::now());
+   }
+
+private:
+   const char *name;
+   Clock::time_point start;
+};
+
+class ScopedTimer
+{
+public:
+   ScopedTimer(Phase phase, uint64_t items = 0)
+      : phase(phase), items(items), start(Clock::now()) {}
+
+   ~ScopedTimer()
+   {
+      Clock::time_point end = Clock::now();
+      PhaseStats &stats = threadPhaseStats();
+      stats.nanos[phase] += std::chrono::duration_cast<
+                               std::chrono::nanoseconds>(end - start).count();
+      stats.calls[phase]++;
+      stats.items[phase] += items;
+      if (tracing.load(std::memory_order_relaxed))
+         threadTrace().record(phaseNames[phase], start, end);
+   }
+
+   void addItems(uint64_t count) { items += count; }
+
+private:
+   Phase phase;
+   uint64_t items;
+   Clock::time_point start;
+};
+}
+
+#endif // GOODNESS_INSTRUMENT_H
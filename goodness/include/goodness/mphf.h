@@ -0,0 +1,97 @@
+/*************************************************************************
+ * PerfectHash
+ *
+ * A minimal perfect hash function in the style of PTHash: maps each of
+ * n distinct 64-bit key hashes to its own slot in [0, n).
+ *
+ * Keys are split into partitions of about `partitionSize` keys, built
+ * independently (and in parallel).  Within a partition each key falls
+ * into one of roughly c * n / log2(n) buckets, skewed so that 60% of
+ * the keys land in 30% of the buckets.  Buckets are placed largest
+ * first: each gets the smallest "pilot" that sends all of its keys to
+ * free slots.  Only the pilots are stored, packed at the width of the
+ * largest one in the partition.
+ *************************************************************************/
+#ifndef GOODNESS_MPHF_H
+#define GOODNESS_MPHF_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "goodness/hash.h"
+
+namespace goodness
+{
+class PerfectHash
+{
+public:
+   // builds over distinct key hashes, in partitions of about
+   // `partitionSize` keys, on `threads` threads (each at least one);
+   // false if some bucket could not be placed (retry with keys hashed
+   // under another seed)
+   bool build(const std::vector<uint64_t> &keys, size_t partitionSize,
+              double c, int threads);
+
+   uint64_t lookup(uint64_t key) const
+   {
+      const Partition &part = partitions[partitionOf(key)];
+      uint64_t pilot = part.pilot(bucketOf(key, part.buckets));
+      return part.offset + slotOf(key, pilot, part.size);
+   }
+
+   size_t bits() const;
+
+private:
+   struct Partition
+   {
+      uint64_t offset;
+      uint32_t size;
+      uint32_t buckets;
+      int width;
+      std::vector<uint64_t> packed;
+
+      uint64_t pilot(size_t bucket) const
+      {
+         if (width == 0)
+            return 0;
+         size_t bit = bucket * width;
+         uint64_t value = packed[bit / 64] >> (bit % 64);
+         if (bit % 64 + width > 64)
+            value |= packed[bit / 64 + 1] << (64 - bit % 64);
+         return value & ((1ULL << width) - 1);
+      }
+   };
+
+   static uint64_t fastRange(uint64_t x, uint64_t n)
+   {
+      return (uint64_t) (((unsigned __int128) x * n) >> 64);
+   }
+
+   size_t partitionOf(uint64_t key) const
+   {
+      return fastRange(mix64(key), partitions.size());
+   }
+
+   static size_t bucketOf(uint64_t key, uint32_t buckets)
+   {
+      uint64_t dense = std::max<uint64_t>(1, buckets * 3 / 10);
+      if ((uint32_t) key % 100 < 60 || dense == buckets)
+         return fastRange(key, dense);
+      return dense + fastRange(key, buckets - dense);
+   }
+
+   static uint64_t slotOf(uint64_t key, uint64_t pilot, uint32_t size)
+   {
+      return fastRange(mix64(key ^ mix64(pilot + 1)), size);
+   }
+
+   static bool buildPartition(Partition &part,
+                              const std::vector<uint64_t> &keys, double c);
+
+   std::vector<Partition> partitions;
+};
+}
+
+#endif // GOODNESS_MPHF_H
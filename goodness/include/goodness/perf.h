@@ -0,0 +1,49 @@
+/*************************************************************************
+ * PerfCounters
+ *
+ * Hardware counters for the calling thread (user space only) read
+ * through Linux perf_event_open as one group, so all of them cover
+ * exactly the same instructions.  If the kernel multiplexes the group
+ * the counts are scaled up by enabled / running time.  open() fails
+ * where perf events are unavailable (another OS, a VM or container
+ * without a PMU, or kernel.perf_event_paranoid above 2); a counter the
+ * CPU lacks is left out and reported as -1.
+ *************************************************************************/
+#ifndef GOODNESS_PERF_H
+#define GOODNESS_PERF_H
+
+#include <vector>
+
+namespace goodness
+{
+enum PerfCounter
+{
+   PERF_CYCLES,
+   PERF_INSTRUCTIONS,
+   PERF_L1D_MISSES,
+   PERF_LLC_MISSES,
+   PERF_BRANCH_MISSES,
+   NUM_PERF_COUNTERS
+};
+
+class PerfCounters
+{
+public:
+   PerfCounters();
+   ~PerfCounters();
+
+   bool open();
+   void start();
+
+   // stops counting and returns the (scaled) counts since start()
+   std::vector<double> stop();
+
+private:
+   PerfCounters(const PerfCounters &);
+   PerfCounters &operator=(const PerfCounters &);
+
+   int fds[NUM_PERF_COUNTERS];
+};
+}
+
+#endif // GOODNESS_PERF_H
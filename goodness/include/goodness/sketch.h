@@ -0,0 +1,165 @@
+/*************************************************************************
+ * Sketches
+ *
+ * Ways to count the distinct values among a hash family's outputs, for
+ * measuring collisions at full width: exactly, with a Bitmap for 32-bit
+ * outputs or by sorting for any width, and approximately in bounded
+ * memory.  A sketch's error on a few hundred thousand keys is far
+ * larger than the number of collisions a good hash has, so sketches
+ * estimate how many distinct values there are, not how many collided.
+ *************************************************************************/
+#ifndef GOODNESS_SKETCH_H
+#define GOODNESS_SKETCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "goodness/hash.h"
+
+namespace goodness
+{
+/*************************************************************************
+ * Bitmap
+ *
+ * An exact set of 32-bit values in the style of a roaring bitmap: the
+ * high 16 bits pick a container, which holds the low 16 bits as a
+ * sorted array while it is sparse and as a 65536-bit bitmap once it
+ * passes 4096 entries.  Memory stays proportional to the number of
+ * values instead of the 512 MB a flat bitmap of 2^32 bits would take.
+ *************************************************************************/
+class Bitmap
+{
+public:
+   Bitmap() : containers(65536), count(0) {}
+
+   // adds a value, returning false if it was already present
+   bool insert(uint32_t value)
+   {
+      Container &c = containers[value >> 16];
+      uint16_t low = value & 0xffff;
+      if (!c.bits.empty())
+      {
+         uint64_t &word = c.bits[low >> 6];
+         uint64_t bit = 1ULL << (low & 63);
+         if (word & bit)
+            return false;
+         word |= bit;
+      }
+      else
+      {
+         std::vector<uint16_t>::iterator at =
+            std::lower_bound(c.values.begin(), c.values.end(), low);
+         if (at != c.values.end() && *at == low)
+            return false;
+         c.values.insert(at, low);
+         if (c.values.size() > ARRAY_LIMIT)
+         {
+            c.bits.assign(1024, 0);
+            for (size_t i = 0; i < c.values.size(); i++)
+               c.bits[c.values[i] >> 6] |= 1ULL << (c.values[i] & 63);
+            std::vector<uint16_t>().swap(c.values);
+         }
+      }
+      count++;
+      return true;
+   }
+
+   uint64_t size() const { return count; }
+   size_t bytes() const;
+
+private:
+   static const size_t ARRAY_LIMIT = 4096;
+
+   struct Container
+   {
+      std::vector<uint16_t> values;
+      std::vector<uint64_t> bits;
+   };
+
+   std::vector<Container> containers;
+   uint64_t count;
+};
+
+/*************************************************************************
+ * HyperLogLog
+ *
+ * Approximate count of distinct values in 2^precision one-byte
+ * registers (standard error about 1.04 / sqrt(2^precision)), with the
+ * usual linear-counting correction for small cardinalities.  The
+ * precision must be from 4 to 18.
+ *************************************************************************/
+class HyperLogLog
+{
+public:
+   HyperLogLog(int precision)
+      : precision(precision), registers(1 << precision, 0) {}
+
+   void add(uint64_t value)
+   {
+      uint64_t x = mix64(value);
+      size_t index = x >> (64 - precision);
+      uint64_t rest = x << precision;
+      uint8_t rank = rest == 0 ? 64 - precision + 1
+                               : __builtin_clzll(rest) + 1;
+      registers[index] = std::max(registers[index], rank);
+   }
+
+   double estimate() const;
+   // the relative standard error of estimate()
+   double standardError() const { return 1.04 / std::sqrt(registers.size()); }
+   size_t bytes() const { return registers.size(); }
+
+private:
+   int precision;
+   std::vector<uint8_t> registers;
+};
+
+/*************************************************************************
+ * MinValues
+ *
+ * A k-minimum-values sketch: keeps the k smallest mixed values seen and
+ * estimates the distinct count from how densely they fill [0, 2^64).
+ * Exact while fewer than k distinct values have been added.  k must be
+ * at least 3.
+ *************************************************************************/
+class MinValues
+{
+public:
+   MinValues(size_t k) : k(k) {}
+
+   void add(uint64_t value)
+   {
+      uint64_t x = mix64(value);
+      if (smallest.size() >= k && x >= *smallest.rbegin())
+         return;
+      if (smallest.insert(x).second && smallest.size() > k)
+         smallest.erase(--smallest.end());
+   }
+
+   double estimate() const;
+   // the relative standard error of estimate(), 0 while it is exact
+   double standardError() const
+   {
+      return smallest.size() < k ? 0 : 1 / std::sqrt((double) k - 2);
+   }
+   size_t bytes() const { return k * sizeof(uint64_t); }
+
+private:
+   size_t k;
+   std::set<uint64_t> smallest;
+};
+
+/*************************************************************************
+ * sortedDistinct
+ *
+ * The exact number of distinct values, at any width, found by sorting
+ * `values` in place.
+ *************************************************************************/
+uint64_t sortedDistinct(std::vector<uint64_t> &values);
+}
+
+#endif // GOODNESS_SKETCH_H
@@ -0,0 +1,107 @@
+/*************************************************************************
+ * Sweep
+ *
+ * Exhaustive search of a space of HashParams small enough to try every
+ * point: all odd multipliers below 2^bits, or every setting of some of
+ * safteyHash's shifts.  It gives the ground truth an annealing or
+ * genetic search can be judged against.  Candidates are scored in
+ * batches with BatchEnergy on every thread, and only the best `top`
+ * are kept, in a heap.  After each batch the state can be written to a
+ * checkpoint file, so a long sweep can stop and resume where it left
+ * off.
+ *************************************************************************/
+#ifndef GOODNESS_SWEEP_H
+#define GOODNESS_SWEEP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "goodness/energy.h"
+#include "goodness/hash.h"
+
+namespace goodness
+{
+/*************************************************************************
+ * SweepSpace
+ *
+ * The points of a sweep, numbered from 0 to size() - 1, each a copy of
+ * `base` with some constants changed.
+ *************************************************************************/
+class SweepSpace
+{
+public:
+   // every odd multiplier below 2^bits (bits at most 32)
+   static SweepSpace multipliers(int bits, const HashParams &base);
+
+   // every value 1..31 of each shift whose position (0..3) is listed
+   static SweepSpace shifts(const std::vector<int> &positions,
+                            const HashParams &base);
+
+   uint64_t size() const { return count; }
+   HashParams at(uint64_t i) const;
+
+   // names the space, e.g. "multipliers/16 shifts=20/12/7/4", so a
+   // checkpoint is only resumed by the same sweep
+   std::string name() const;
+
+private:
+   SweepSpace() : bits(0), count(0) {}
+
+   HashParams base;
+   int bits;                    // multiplier sweep, or 0
+   std::vector<int> positions;  // shift sweep
+   uint64_t count;
+};
+
+struct SweepEntry
+{
+   uint64_t index;
+   double energy;
+};
+
+/*************************************************************************
+ * Sweep
+ *
+ * A sweep in progress: run() scores up to `limit` more points in
+ * batches of `batch`.  `top` holds the best points so far, best first,
+ * ties going to the lower index.  `better` counts the points better
+ * than `reference`, the energy of the space's base.
+ *************************************************************************/
+class Sweep
+{
+public:
+   Sweep(const SweepSpace &space, size_t topK, double reference)
+      : space(space), topK(topK), reference(reference), next(0), better(0)
+   {}
+
+   // false if the file is missing or from a different sweep
+   bool load(const std::string &checkpoint);
+   bool save(const std::string &checkpoint) const;
+
+   // scores the next points; after each batch writes `checkpoint` (if
+   // not empty) and calls `progress` (if not NULL) with this Sweep.
+   // False, stopping after that batch, if the checkpoint could not be
+   // written.
+   bool run(BatchEnergy &energy, uint64_t limit, uint64_t batch,
+            const std::string &checkpoint,
+            void (*progress)(const Sweep &sweep) = NULL);
+
+   bool done() const { return next >= space.size(); }
+   std::vector<SweepEntry> top() const;
+
+   const SweepSpace space;
+   const size_t topK;
+   const double reference;
+   uint64_t next;               // points before this one are scored
+   uint64_t better;
+
+private:
+   void add(uint64_t index, double energy);
+
+   std::vector<SweepEntry> heap;     // the worst kept point first
+};
+}
+
+#endif // GOODNESS_SWEEP_H
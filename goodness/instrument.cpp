@@ -0,0 +1,221 @@
+/*************************************************************************
+ * Instrumentation
+ *
+ * Per-thread phase timers and trace buffers; see goodness/instrument.h.
+ *************************************************************************/
+#include "goodness/instrument.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace goodness
+{
+double nanosSince(Clock::time_point start)
+{
+   return chrono::duration<double, nano>(Clock::now() - start).count();
+}
+
+const char *phaseNames[NUM_PHASES] =
+{
+   "load", "tokenize", "hash", "histogram", "energy", "anneal-step"
+};
+
+mutex phaseStatsLock;
+vector<unique_ptr<PhaseStats> > allPhaseStats;   // one per live thread
+vector<PhaseStats *> freePhaseStats;             // left by exited threads
+
+/*************************************************************************
+ * ThreadSlot
+ *
+ * A thread's PhaseStats or ThreadTrace.  When the thread exits, the
+ * slot goes onto a free list, keeping what it recorded, and the next
+ * new thread takes it over.  So there are only as many slots as
+ * threads were ever alive at once.
+ *************************************************************************/
+template <class T>
+struct ThreadSlot
+{
+   T *slot;
+   vector<T *> &freeSlots;
+
+   ThreadSlot(vector<T *> &freeSlots) : slot(NULL), freeSlots(freeSlots) {}
+
+   ~ThreadSlot()
+   {
+      if (!slot)
+         return;
+      lock_guard<mutex> lock(phaseStatsLock);
+      freeSlots.push_back(slot);
+   }
+
+   // a free slot if there is one, otherwise a new one made by `make`
+   // and kept in `all`; called with phaseStatsLock held
+   template <class Make>
+   void take(vector<unique_ptr<T> > &all, Make make)
+   {
+      if (freeSlots.empty())
+      {
+         all.push_back(unique_ptr<T>(make()));
+         slot = all.back().get();
+      }
+      else
+      {
+         slot = freeSlots.back();
+         freeSlots.pop_back();
+      }
+   }
+};
+
+PhaseStats &threadPhaseStats()
+{
+   thread_local ThreadSlot<PhaseStats> stats(freePhaseStats);
+   if (!stats.slot)
+   {
+      lock_guard<mutex> lock(phaseStatsLock);
+      stats.take(allPhaseStats, []() { return new PhaseStats; });
+   }
+   return *stats.slot;
+}
+
+PhaseStats totalPhaseStats(int *threads)
+{
+   lock_guard<mutex> lock(phaseStatsLock);
+   PhaseStats total;
+   *threads = 0;
+   for (size_t t = 0; t < allPhaseStats.size(); t++)
+   {
+      bool used = false;
+      for (int p = 0; p < NUM_PHASES; p++)
+      {
+         total.nanos[p] += allPhaseStats[t]->nanos[p];
+         total.calls[p] += allPhaseStats[t]->calls[p];
+         total.items[p] += allPhaseStats[t]->items[p];
+         used = used || allPhaseStats[t]->calls[p] > 0;
+      }
+      *threads += used;
+   }
+   return total;
+}
+
+void resetPhaseStats()
+{
+   lock_guard<mutex> lock(phaseStatsLock);
+   for (size_t t = 0; t < allPhaseStats.size(); t++)
+      allPhaseStats[t]->reset();
+}
+
+void reportPhaseStats(const string &test, double wallNanos, const string &json)
+{
+   int threads;
+   PhaseStats total = totalPhaseStats(&threads);
+
+   cerr << "-- " << test << ": " << fixed << setprecision(3)
+        << wallNanos / 1e6 << " ms wall, " << threads << " thread(s)" << endl;
+   cerr << left << setw(14) << "phase" << right << setw(10) << "calls"
+        << setw(14) << "total ms" << setw(12) << "ms/call"
+        << setw(14) << "items" << setw(16) << "ns/item" << endl;
+   for (int p = 0; p < NUM_PHASES; p++)
+   {
+      if (total.calls[p] == 0)
+         continue;
+      cerr << left << setw(14) << phaseNames[p] << right
+           << setw(10) << total.calls[p]
+           << setw(14) << total.nanos[p] / 1e6
+           << setw(12) << total.nanos[p] / 1e6 / total.calls[p]
+           << setw(14) << total.items[p]
+           << setw(16) << (total.items[p] ? (double) total.nanos[p] /
+                                            total.items[p] : 0.0)
+           << endl;
+   }
+   cerr.unsetf(ios::fixed);
+   cerr << setprecision(6);
+
+   if (json.empty())
+      return;
+   ofstream fout(json.c_str(), ios::app);
+   fout << "{\"test\":\"" << test << "\",\"wall_ns\":" << (uint64_t) wallNanos
+        << ",\"threads\":" << threads << ",\"phases\":{";
+   bool first = true;
+   for (int p = 0; p < NUM_PHASES; p++)
+   {
+      if (total.calls[p] == 0)
+         continue;
+      fout << (first ? "" : ",") << "\"" << phaseNames[p] << "\":{"
+           << "\"calls\":" << total.calls[p]
+           << ",\"ns\":" << total.nanos[p]
+           << ",\"items\":" << total.items[p] << "}";
+      first = false;
+   }
+   fout << "}}" << endl;
+}
+
+atomic<bool> tracing(false);
+Clock::time_point traceEpoch;
+
+// guarded by phaseStatsLock, like the PhaseStats
+vector<unique_ptr<ThreadTrace> > allThreadTraces;
+vector<ThreadTrace *> freeThreadTraces;
+
+ThreadTrace &threadTrace()
+{
+   thread_local ThreadSlot<ThreadTrace> trace(freeThreadTraces);
+   if (!trace.slot)
+   {
+      lock_guard<mutex> lock(phaseStatsLock);
+      trace.take(allThreadTraces, []()
+      {
+         return new ThreadTrace(allThreadTraces.size());
+      });
+   }
+   return *trace.slot;
+}
+
+void startTracing()
+{
+   if (!tracing.load(memory_order_relaxed))
+      traceEpoch = Clock::now();
+   tracing.store(true, memory_order_relaxed);
+}
+
+void writeTrace(const string &file)
+{
+   ofstream fout(file.c_str());
+   if (fout.fail())
+   {
+      cerr << "Error writing " << file << endl;
+      return;
+   }
+
+   lock_guard<mutex> lock(phaseStatsLock);
+   fout << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << endl;
+   fout << fixed << setprecision(3);
+   bool first = true;
+   for (size_t t = 0; t < allThreadTraces.size(); t++)
+   {
+      const ThreadTrace &trace = *allThreadTraces[t];
+      fout << (first ? "" : ",\n")
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+           << trace.id << ",\"args\":{\"name\":\""
+           << (trace.id == 0 ? "main" : "worker " + to_string(trace.id))
+           << "\"}}";
+      first = false;
+
+      uint64_t begin = trace.written > TRACE_CAPACITY
+                          ? trace.written - TRACE_CAPACITY : 0;
+      for (uint64_t e = begin; e < trace.written; e++)
+      {
+         const TraceEvent &event = trace.events[e % TRACE_CAPACITY];
+         fout << ",\n{\"name\":\"" << event.name
+              << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace.id
+              << ",\"ts\":" << event.start / 1e3
+              << ",\"dur\":" << event.duration / 1e3 << "}";
+      }
+   }
+   fout << endl << "]}" << endl;
+}
+}
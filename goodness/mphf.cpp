@@ -0,0 +1,124 @@
+/*************************************************************************
+ * PerfectHash
+ *
+ * Building the minimal perfect hash; see goodness/mphf.h.
+ *************************************************************************/
+#include "goodness/mphf.h"
+
+#include <cmath>
+#include <thread>
+
+using namespace std;
+
+namespace goodness
+{
+bool PerfectHash::build(const vector<uint64_t> &keys, size_t partitionSize,
+                        double c, int threads)
+{
+   partitionSize = max<size_t>(partitionSize, 1);
+   size_t count = max<size_t>(1, (keys.size() + partitionSize - 1) /
+                                 partitionSize);
+   partitions.assign(count, Partition());
+
+   vector<vector<uint64_t> > split(count);
+   for (size_t i = 0; i < keys.size(); i++)
+      split[partitionOf(keys[i])].push_back(keys[i]);
+
+   uint64_t offset = 0;
+   for (size_t p = 0; p < count; p++)
+   {
+      partitions[p].offset = offset;
+      offset += split[p].size();
+   }
+
+   // at least one thread, or no partition would be built
+   threads = max(threads, 1);
+   vector<char> ok(count, 1);
+   vector<thread> workers;
+   for (int t = 0; t < threads; t++)
+      workers.push_back(thread([&, t]()
+      {
+         for (size_t p = t; p < count; p += threads)
+            ok[p] = buildPartition(partitions[p], split[p], c);
+      }));
+   for (size_t t = 0; t < workers.size(); t++)
+      workers[t].join();
+
+   return find(ok.begin(), ok.end(), 0) == ok.end();
+}
+
+size_t PerfectHash::bits() const
+{
+   size_t total = partitions.size() * sizeof(Partition) * 8;
+   for (size_t p = 0; p < partitions.size(); p++)
+      total += partitions[p].packed.size() * 64;
+   return total;
+}
+
+bool PerfectHash::buildPartition(Partition &part, const vector<uint64_t> &keys,
+                                 double c)
+{
+   part.size = keys.size();
+   part.buckets = max(1.0, ceil(c * keys.size() /
+                                log2(keys.size() + 2.0)));
+   part.width = 0;
+   if (keys.empty())
+      return true;
+
+   // keys grouped by bucket, then buckets ordered largest first
+   vector<vector<uint64_t> > buckets(part.buckets);
+   size_t largest = 0;
+   for (size_t i = 0; i < keys.size(); i++)
+   {
+      vector<uint64_t> &bucket = buckets[bucketOf(keys[i], part.buckets)];
+      bucket.push_back(keys[i]);
+      largest = max(largest, bucket.size());
+   }
+   vector<vector<uint32_t> > bySize(largest + 1);
+   for (uint32_t b = 0; b < part.buckets; b++)
+      bySize[buckets[b].size()].push_back(b);
+
+   vector<char> taken(part.size, 0);
+   vector<uint64_t> pilots(part.buckets, 0);
+   vector<uint64_t> slots;
+   for (size_t size = largest; size > 0; size--)
+      for (size_t i = 0; i < bySize[size].size(); i++)
+      {
+         uint32_t b = bySize[size][i];
+         uint64_t pilot = 0;
+         for (;; pilot++)
+         {
+            if (pilot >= (1ULL << 24))
+               return false;
+            slots.clear();
+            size_t k = 0;
+            for (; k < size; k++)
+            {
+               uint64_t slot = slotOf(buckets[b][k], pilot, part.size);
+               if (taken[slot] ||
+                   find(slots.begin(), slots.end(), slot) != slots.end())
+                  break;
+               slots.push_back(slot);
+            }
+            if (k == size)
+               break;
+         }
+         for (size_t k = 0; k < slots.size(); k++)
+            taken[slots[k]] = 1;
+         pilots[b] = pilot;
+      }
+
+   uint64_t maxPilot = *max_element(pilots.begin(), pilots.end());
+   while (maxPilot >> part.width)
+      part.width++;
+   part.packed.assign((pilots.size() * part.width + 63) / 64 + 1, 0);
+   for (size_t b = 0; b < pilots.size(); b++)
+   {
+      size_t bit = b * part.width;
+      part.packed[bit / 64] |= pilots[b] << (bit % 64);
+      if (bit % 64 + part.width > 64)
+         part.packed[bit / 64 + 1] |= pilots[b] >> (64 - bit % 64);
+   }
+   return true;
+}
+}
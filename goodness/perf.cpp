@@ -0,0 +1,104 @@
+/*************************************************************************
+ * PerfCounters
+ *
+ * Grouped hardware counters through perf_event_open; see
+ * goodness/perf.h.
+ *************************************************************************/
+#include "goodness/perf.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define HAVE_PERF_EVENTS 1
+#endif
+
+using namespace std;
+
+namespace goodness
+{
+PerfCounters::PerfCounters()
+{
+   for (int c = 0; c < NUM_PERF_COUNTERS; c++)
+      fds[c] = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef HAVE_PERF_EVENTS
+   for (int c = 0; c < NUM_PERF_COUNTERS; c++)
+      if (fds[c] >= 0)
+         close(fds[c]);
+#endif
+}
+
+bool PerfCounters::open()
+{
+#ifdef HAVE_PERF_EVENTS
+   const uint32_t types[NUM_PERF_COUNTERS] =
+   {
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+   };
+   const uint64_t configs[NUM_PERF_COUNTERS] =
+   {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES
+   };
+
+   for (int c = 0; c < NUM_PERF_COUNTERS; c++)
+   {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = types[c];
+      attr.config = configs[c];
+      attr.disabled = c == 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP |
+                         PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds[c] = syscall(SYS_perf_event_open, &attr, 0, -1,
+                       c == 0 ? -1 : fds[0], 0);
+      if (fds[0] < 0)
+         return false;
+   }
+   return true;
+#else
+   return false;
+#endif
+}
+
+void PerfCounters::start()
+{
+#ifdef HAVE_PERF_EVENTS
+   ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+   ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+vector<double> PerfCounters::stop()
+{
+   vector<double> counts(NUM_PERF_COUNTERS, 0);
+#ifdef HAVE_PERF_EVENTS
+   ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+   // nr, time enabled, time running, then one value per open counter
+   uint64_t values[3 + NUM_PERF_COUNTERS];
+   if (read(fds[0], values, sizeof(values)) < 3 * (ssize_t) sizeof(uint64_t))
+      return counts;
+   double scale = values[2] ? (double) values[1] / values[2] : 0;
+   for (int c = 0, v = 3; c < NUM_PERF_COUNTERS; c++)
+      counts[c] = fds[c] >= 0 ? values[v++] * scale : -1;
+#endif
+   return counts;
+}
+}
@@ -0,0 +1,52 @@
+/*************************************************************************
+ * Sketches
+ *
+ * Bitmap, HyperLogLog and MinValues; see goodness/sketch.h.
+ *************************************************************************/
+#include "goodness/sketch.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace goodness
+{
+size_t Bitmap::bytes() const
+{
+   size_t total = containers.size() * sizeof(Container);
+   for (size_t i = 0; i < containers.size(); i++)
+      total += containers[i].values.capacity() * sizeof(uint16_t) +
+               containers[i].bits.capacity() * sizeof(uint64_t);
+   return total;
+}
+
+double HyperLogLog::estimate() const
+{
+   double m = registers.size();
+   double sum = 0;
+   int zeros = 0;
+   for (size_t i = 0; i < registers.size(); i++)
+   {
+      sum += ldexp(1.0, -registers[i]);
+      zeros += registers[i] == 0;
+   }
+   double alpha = 0.7213 / (1 + 1.079 / m);
+   double estimate = alpha * m * m / sum;
+   if (estimate <= 2.5 * m && zeros > 0)
+      estimate = m * log(m / zeros);
+   return estimate;
+}
+
+double MinValues::estimate() const
+{
+   if (smallest.size() < k)
+      return smallest.size();
+   return (k - 1) / ldexp((double) *smallest.rbegin(), -64);
+}
+
+uint64_t sortedDistinct(vector<uint64_t> &values)
+{
+   sort(values.begin(), values.end());
+   return unique(values.begin(), values.end()) - values.begin();
+}
+}
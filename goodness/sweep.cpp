@@ -0,0 +1,180 @@
+/*************************************************************************
+ * Sweep
+ *
+ * Exhaustive search of a small space of HashParams; see
+ * goodness/sweep.h.
+ *************************************************************************/
+#include "goodness/sweep.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace goodness
+{
+SweepSpace SweepSpace::multipliers(int bits, const HashParams &base)
+{
+   SweepSpace space;
+   space.base = base;
+   space.bits = max(1, min(bits, 32));
+   space.count = (uint64_t) 1 << (space.bits - 1);
+   return space;
+}
+
+SweepSpace SweepSpace::shifts(const vector<int> &positions,
+                              const HashParams &base)
+{
+   SweepSpace space;
+   space.base = base;
+   space.count = 1;
+   for (size_t p = 0; p < positions.size(); p++)
+      if (positions[p] >= 0 && positions[p] < 4 &&
+          find(space.positions.begin(), space.positions.end(),
+               positions[p]) == space.positions.end())
+      {
+         space.positions.push_back(positions[p]);
+         space.count *= 31;
+      }
+   return space;
+}
+
+HashParams SweepSpace::at(uint64_t i) const
+{
+   HashParams params = base;
+   if (bits)
+      params.multiplier = (unsigned int) (2 * i + 1);
+   else
+      for (size_t p = 0; p < positions.size(); p++, i /= 31)
+         params.shifts[positions[p]] = 1 + (int) (i % 31);
+   return params;
+}
+
+string SweepSpace::name() const
+{
+   ostringstream out;
+   if (bits)
+      out << "multipliers/" << bits;
+   else
+   {
+      out << "shifts/";
+      for (size_t p = 0; p < positions.size(); p++)
+         out << positions[p];
+   }
+   out << " from " << base;
+   return out.str();
+}
+
+// the order of the heap and of top(): lower energy, then lower index
+static bool ranksBefore(const SweepEntry &a, const SweepEntry &b)
+{
+   return a.energy < b.energy || (a.energy == b.energy && a.index < b.index);
+}
+
+void Sweep::add(uint64_t index, double energy)
+{
+   SweepEntry entry = { index, energy };
+   if (energy < reference)
+      better++;
+   if (heap.size() < topK)
+   {
+      heap.push_back(entry);
+      push_heap(heap.begin(), heap.end(), ranksBefore);
+   }
+   else if (topK && ranksBefore(entry, heap.front()))
+   {
+      pop_heap(heap.begin(), heap.end(), ranksBefore);
+      heap.back() = entry;
+      push_heap(heap.begin(), heap.end(), ranksBefore);
+   }
+}
+
+vector<SweepEntry> Sweep::top() const
+{
+   vector<SweepEntry> sorted = heap;
+   sort(sorted.begin(), sorted.end(), ranksBefore);
+   return sorted;
+}
+
+bool Sweep::run(BatchEnergy &energy, uint64_t limit, uint64_t batch,
+                const string &checkpoint, void (*progress)(const Sweep &))
+{
+   uint64_t end = min(space.size(), next + min(limit, space.size()));
+   vector<HashParams> candidates;
+   vector<double> energies;
+   while (next < end)
+   {
+      uint64_t stop = min(end, next + max<uint64_t>(batch, 1));
+      candidates.clear();
+      for (uint64_t i = next; i < stop; i++)
+         candidates.push_back(space.at(i));
+      energy(candidates, energies);
+      for (uint64_t i = next; i < stop; i++)
+         add(i, energies[i - next]);
+      next = stop;
+
+      if (!checkpoint.empty() && !save(checkpoint))
+         return false;
+      if (progress)
+         progress(*this);
+   }
+   return true;
+}
+
+/*************************************************************************
+ * load / save
+ *
+ * The checkpoint is text: a header line, the space's name, the top-K
+ * size and reference energy, the next point and the count of better
+ * points, then one line per kept point.  Energies are written with 17
+ * digits so a resumed sweep ranks exactly as an uninterrupted one.  It
+ * is written to a temporary file and renamed over the old one, so an
+ * interrupted save leaves the previous checkpoint intact.
+ *************************************************************************/
+bool Sweep::load(const string &checkpoint)
+{
+   ifstream fin(checkpoint.c_str());
+   string header, name;
+   size_t savedTopK;
+   double savedReference;
+   if (!getline(fin, header) || header != "goodness sweep checkpoint" ||
+       !getline(fin, name) || name != space.name() ||
+       !(fin >> savedTopK >> savedReference) || savedTopK != topK ||
+       savedReference != reference)
+      return false;
+
+   uint64_t savedNext, savedBetter;
+   size_t kept;
+   if (!(fin >> savedNext >> savedBetter >> kept))
+      return false;
+   vector<SweepEntry> entries(kept);
+   for (size_t i = 0; i < kept; i++)
+      if (!(fin >> entries[i].index >> entries[i].energy))
+         return false;
+
+   next = savedNext;
+   better = savedBetter;
+   heap = entries;
+   make_heap(heap.begin(), heap.end(), ranksBefore);
+   return true;
+}
+
+bool Sweep::save(const string &checkpoint) const
+{
+   string temporary = checkpoint + ".tmp";
+   {
+      ofstream fout(temporary.c_str());
+      fout << "goodness sweep checkpoint" << endl << space.name() << endl
+           << setprecision(17) << topK << ' ' << reference << endl
+           << next << ' ' << better << ' ' << heap.size() << endl;
+      for (size_t i = 0; i < heap.size(); i++)
+         fout << heap[i].index << ' ' << heap[i].energy << endl;
+      if (!fout.flush())
+         return false;
+   }
+   return rename(temporary.c_str(), checkpoint.c_str()) == 0;
+}
+}